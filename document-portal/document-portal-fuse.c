@@ -287,24 +287,24 @@ static int ensure_docdir_inode (XdpInode *parent,
 static void queue_invalidate_dentry (XdpInode *parent, const char *name);
 
 static gboolean
-app_can_write_doc (PermissionDbEntry *entry, const char *app_id)
+app_can_write_doc (const char *doc_id, const char *app_id)
 {
   if (app_id == NULL)
     return TRUE;
 
-  if (document_entry_has_permissions_by_app_id (entry, app_id, DOCUMENT_PERMISSION_FLAGS_WRITE))
+  if (xdp_lookup_doc_permissions (doc_id, app_id) & DOCUMENT_PERMISSION_FLAGS_WRITE)
     return TRUE;
 
   return FALSE;
 }
 
 static gboolean
-app_can_see_doc (PermissionDbEntry *entry, const char *app_id)
+app_can_see_doc (const char *doc_id, const char *app_id)
 {
   if (app_id == NULL)
     return TRUE;
 
-  if (document_entry_has_permissions_by_app_id (entry, app_id, DOCUMENT_PERMISSION_FLAGS_READ))
+  if (xdp_lookup_doc_permissions (doc_id, app_id) & DOCUMENT_PERMISSION_FLAGS_READ)
     return TRUE;
 
   return FALSE;
@@ -662,14 +662,9 @@ xdp_domain_new_document (XdpDomain         *parent,
 static gboolean
 xdp_document_domain_can_see (XdpDomain *domain)
 {
-  if (domain->app_id != NULL)
-    {
-      g_autoptr(PermissionDbEntry) entry = xdp_lookup_doc (domain->doc_id);
-
-      if (entry == NULL ||
-          !app_can_see_doc (entry, domain->app_id))
-        return FALSE;
-    }
+  if (domain->app_id != NULL &&
+      !app_can_see_doc (domain->doc_id, domain->app_id))
+    return FALSE;
 
   return TRUE;
 }
@@ -677,14 +672,9 @@ xdp_document_domain_can_see (XdpDomain *domain)
 static gboolean
 xdp_document_domain_can_write (XdpDomain *domain)
 {
-  if (domain->app_id != NULL)
-    {
-      g_autoptr(PermissionDbEntry) entry = xdp_lookup_doc (domain->doc_id);
-
-      if (entry == NULL ||
-          !app_can_write_doc (entry, domain->app_id))
-        return FALSE;
-    }
+  if (domain->app_id != NULL &&
+      !app_can_write_doc (domain->doc_id, domain->app_id))
+    return FALSE;
 
   return TRUE;
 }
@@ -1425,12 +1415,9 @@ stat_virtual_inode (XdpInode    *inode,
       buf->st_nlink = 2;
 
       /* Remove perms if not writable */
-      if (inode->domain->app_id != NULL)
-        {
-          g_autoptr(PermissionDbEntry) entry = xdp_lookup_doc (inode->domain->doc_id);
-          if (entry == NULL || !app_can_write_doc (entry, inode->domain->app_id))
-            buf->st_mode &= ~(0222);
-        }
+      if (inode->domain->app_id != NULL &&
+          !app_can_write_doc (inode->domain->doc_id, inode->domain->app_id))
+        buf->st_mode &= ~(0222);
       break;
 
     default:
@@ -1757,7 +1744,7 @@ ensure_doc_inode (XdpInode   *parent,
 
   if (doc_entry == NULL ||
       (parent_domain->app_id &&
-       !app_can_see_doc (doc_entry, parent_domain->app_id)))
+       !app_can_see_doc (doc_id, parent_domain->app_id)))
     return NULL;
 
   G_LOCK (domain_inodes);
@@ -2269,13 +2256,8 @@ xdp_dir_add_docs (XdpDir     *d,
   docs = xdp_list_docs ();
   for (i = 0; docs[i] != NULL; i++)
     {
-      if (for_app_id)
-        {
-          g_autoptr(PermissionDbEntry) entry = xdp_lookup_doc (docs[i]);
-          if (entry == NULL ||
-              !app_can_see_doc (entry, for_app_id))
-            continue;
-        }
+      if (for_app_id && !app_can_see_doc (docs[i], for_app_id))
+        continue;
 
       xdp_dir_add (d, req, docs[i], S_IFDIR);
     }
@@ -3,12 +3,15 @@
 
 #include <glib.h>
 #include "permission-db.h"
+#include "document-enums.h"
 
 G_BEGIN_DECLS
 
 char **        xdp_list_apps (void);
 char **        xdp_list_docs (void);
 PermissionDbEntry *xdp_lookup_doc (const char *doc_id);
+DocumentPermissionFlags xdp_lookup_doc_permissions (const char *doc_id,
+                                                    const char *app_id);
 
 gboolean    xdp_fuse_init (GError **error);
 void        xdp_fuse_exit (void);
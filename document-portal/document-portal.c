@@ -69,6 +69,11 @@ static dev_t fuse_dev = 0;
 static GQueue get_mount_point_invocations = G_QUEUE_INIT;
 static XdpDbusDocuments *dbus_api;
 
+/* Map doc id => (app id => DocumentPermissionFlags), decoded lazily from
+ * the current entry of each document. Protected by the db lock, and
+ * dropped whenever the entry of the document is replaced. */
+static GHashTable *doc_permissions = NULL;
+
 G_LOCK_DEFINE (db);
 
 char **
@@ -92,6 +97,41 @@ xdp_lookup_doc (const char *doc_id)
   return permission_db_lookup (db, doc_id);
 }
 
+DocumentPermissionFlags
+xdp_lookup_doc_permissions (const char *doc_id,
+                            const char *app_id)
+{
+  GHashTable *app_permissions;
+
+  if (strcmp (app_id, "") == 0)
+    return DOCUMENT_PERMISSION_FLAGS_ALL;
+
+  XDP_AUTOLOCK (db);
+
+  app_permissions = g_hash_table_lookup (doc_permissions, doc_id);
+  if (app_permissions == NULL)
+    {
+      g_autoptr(PermissionDbEntry) entry = permission_db_lookup (db, doc_id);
+
+      if (entry == NULL)
+        return 0;
+
+      app_permissions = document_entry_decode_permissions (entry);
+      g_hash_table_insert (doc_permissions, g_strdup (doc_id), app_permissions);
+    }
+
+  return GPOINTER_TO_UINT (g_hash_table_lookup (app_permissions, app_id));
+}
+
+/* Must be called with the db lock held */
+static void
+set_entry (const char        *doc_id,
+           PermissionDbEntry *entry)
+{
+  permission_db_set_entry (db, doc_id, entry);
+  g_hash_table_remove (doc_permissions, doc_id);
+}
+
 static gboolean
 persist_entry (PermissionDbEntry *entry)
 {
@@ -113,7 +153,7 @@ do_set_permissions (PermissionDbEntry    *entry,
   g_debug ("set_permissions %s %s %x", doc_id, app_id, perms);
 
   new_entry = permission_db_entry_set_app_permissions (entry, app_id, perms_s);
-  permission_db_set_entry (db, doc_id, new_entry);
+  set_entry (doc_id, new_entry);
 
   if (persist_entry (new_entry))
     {
@@ -290,7 +330,7 @@ portal_delete (GDBusMethodInvocation *invocation,
 
     g_debug ("delete %s", id);
 
-    permission_db_set_entry (db, id, NULL);
+    set_entry (id, NULL);
 
     if (persist_entry (entry))
       xdg_permission_store_call_delete (permission_store, TABLE_NAME,
@@ -353,7 +393,7 @@ do_create_doc (struct stat *parent_st_buf, const char *path, gboolean reuse_exis
   g_debug ("create_doc %s", id);
 
   entry = permission_db_entry_new (data);
-  permission_db_set_entry (db, id, entry);
+  set_entry (id, entry);
 
   if (persistent)
     {
@@ -1757,6 +1797,9 @@ main (int    argc,
       exit (2);
     }
 
+  doc_permissions = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, (GDestroyNotify) g_hash_table_unref);
+
   session_bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
   if (session_bus == NULL)
     {
@@ -79,6 +79,32 @@ document_entry_get_permissions (PermissionDbEntry *entry,
   return document_entry_get_permissions_by_app_id (entry, app_id);
 }
 
+/* Transfer: full
+ * Decodes all app permissions of an entry snapshot into a
+ * map of app id => DocumentPermissionFlags */
+GHashTable *
+document_entry_decode_permissions (PermissionDbEntry *entry)
+{
+  g_autofree const char **apps = NULL;
+  GHashTable *res;
+  int i;
+
+  res = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  apps = permission_db_entry_list_apps (entry);
+  for (i = 0; apps[i] != NULL; i++)
+    {
+      g_autofree const char **permissions = NULL;
+
+      permissions = permission_db_entry_list_permissions (entry, apps[i]);
+      g_hash_table_insert (res,
+                           g_strdup (apps[i]),
+                           GUINT_TO_POINTER (xdp_parse_permissions (permissions, NULL)));
+    }
+
+  return res;
+}
+
 gboolean
 document_entry_has_permissions_by_app_id (PermissionDbEntry       *entry,
                                           const char              *app_id,
@@ -20,6 +20,7 @@ DocumentPermissionFlags document_entry_get_permissions_by_app_id (PermissionDbEn
                                                                   const char        *app_id);
 DocumentPermissionFlags document_entry_get_permissions (PermissionDbEntry *entry,
                                                         XdpAppInfo        *app_info);
+GHashTable *       document_entry_decode_permissions (PermissionDbEntry *entry);
 gboolean           document_entry_has_permissions (PermissionDbEntry       *entry,
                                                    XdpAppInfo              *app_info,
                                                    DocumentPermissionFlags  perms);
@@ -23,7 +23,10 @@
 #include "config.h"
 
 #include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include <glib/gi18n.h>
+#include <glib-unix.h>
 #include <gio/gio.h>
 #include <gio/gdesktopappinfo.h>
 
@@ -50,8 +53,9 @@
  * state from the compositor, and comparing that list to
  * the list of running flatpak instances obtained from
  * $XDG_RUNTIME_DIR/.flatpak/. A thread is comparing
- * this list every minute, and if it finds an app that
- * is in the background twice, we take actions:
+ * this list whenever either of them changes, and if it
+ * finds an app that stays in the background for a few
+ * seconds, we take actions:
  * - if the permission is NO, we kill it
  * - if the permission is YES or ASK, we notify the user
  *
@@ -221,22 +225,35 @@ set_permission (const char *app_id,
 
 /* background monitor */
 
-/* The background monitor is running in a dedicated thread.
+/* The background monitor is running in a dedicated thread, with its own
+ * main context.
  *
  * We rely on the RunningApplicationsChanged signal from the backend to get
- * notified about applications that start or stop having open windows, and on
- * file monitoring to learn about flatpak instances appearing and disappearing.
+ * notified about applications that start or stop having open windows, on
+ * file monitoring to learn about flatpak instances appearing, and on a pidfd
+ * per instance to learn about them exiting.
  *
- * When either of these changes happens, we wake up the background monitor
- * thread, and it will check the state of applications a few times, with a
- * few seconds of wait in between. When we find an application in the background
- * more than once, we check the permissions, and kill or notify if warranted.
+ * When any of these changes happens, the background monitor thread checks
+ * the state of applications. When it finds an application in the background,
+ * it starts a timer for that instance. If the application is still in the
+ * background when the timer fires, we check the permissions, and kill or
+ * notify if warranted.
  *
- * We require an application to be in background state for more than once check
- * to avoid killing an unlucky application that just happened to start up as we
- * did our check.
+ * The grace period avoids killing an unlucky application that just happened
+ * to start up as we did our check. Nothing runs while nothing changes.
  */
 
+/* How long to wait for more changes before checking */
+#define CHECK_DELAY_MS 500
+/* How long an app must stay in the background before we act */
+#define BACKGROUND_GRACE_PERIOD_MS 5000
+/* How long to wait before looking at incomplete instances again, doubled
+ * after every attempt */
+#define INCOMPLETE_RETRY_DELAY_MS 1000
+#define MAX_INCOMPLETE_RETRIES 5
+
+static GMainContext *monitor_context;
+
 static GHashTable *
 get_app_states (void)
 {
@@ -284,13 +301,28 @@ typedef struct {
   gboolean notified;
   XdpPermission permission;
   char *status_message;
+
+  /* Only accessed from the monitor thread */
+  GSource *grace_source;
+  gint64 background_since;
 } InstanceData;
 
+static void
+clear_source (GSource **source)
+{
+  if (*source)
+    {
+      g_source_destroy (*source);
+      g_clear_pointer (source, g_source_unref);
+    }
+}
+
 static void
 instance_data_free (gpointer data)
 {
   InstanceData *idata = data;
 
+  clear_source (&idata->grace_source);
   g_object_unref (idata->instance);
   g_free (idata->status_message);
   g_free (idata->handle);
@@ -477,7 +509,8 @@ notify_background_done (GObject *source,
                  "system settings of your desktop environment.",
                  nd->app_id, nd->child_pid);
 
-      kill (nd->child_pid, SIGKILL);
+      if (nd->child_pid > 0)
+        kill (nd->child_pid, SIGKILL);
     }
   else if (result == IGNORE)
     {
@@ -501,15 +534,288 @@ notify_background_done (GObject *source,
   notification_data_free (nd);
 }
 
+static GSource *check_source; /* only accessed from the monitor thread */
+
+static void check_background_apps (void);
+
+static gboolean
+check_background_apps_cb (gpointer data)
+{
+  g_clear_pointer (&check_source, g_source_unref);
+  check_background_apps ();
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Called in the monitor thread. Changes tend to come in bursts, so they
+ * are handled together. */
+static void
+queue_check (void)
+{
+  if (check_source)
+    return;
+
+  check_source = g_timeout_source_new (CHECK_DELAY_MS);
+  g_source_set_callback (check_source, check_background_apps_cb, NULL, NULL);
+  g_source_attach (check_source, monitor_context);
+}
+
+static gboolean
+queue_check_cb (gpointer data)
+{
+  queue_check ();
+
+  return G_SOURCE_REMOVE;
+}
+
+/* The flatpak instances are loaded once, and then kept up to date from
+ * the instance directory monitor, and from a pidfd per instance. Flatpak
+ * only removes the directories of exited instances when it runs the next
+ * time, so these stay around, but they cost nothing.
+ */
+typedef struct {
+  FlatpakInstance *instance;
+  int pidfd;
+  GSource *exit_source;
+  gboolean exited;
+} InstanceEntry;
+
+/* instance ID -> InstanceEntry, only accessed from the monitor thread */
+static GHashTable *instances;
+
+static void
+instance_entry_free (gpointer data)
+{
+  InstanceEntry *entry = data;
+
+  clear_source (&entry->exit_source);
+  g_clear_fd (&entry->pidfd, NULL);
+  g_object_unref (entry->instance);
+
+  g_free (entry);
+}
+
+static gboolean
+instance_exited_cb (int           fd,
+                    GIOCondition  condition,
+                    gpointer      user_data)
+{
+  InstanceEntry *entry = user_data;
+
+  g_debug ("Instance %s exited", flatpak_instance_get_id (entry->instance));
+
+  entry->exited = TRUE;
+  g_clear_pointer (&entry->exit_source, g_source_unref);
+  queue_check ();
+
+  return G_SOURCE_REMOVE;
+}
+
+static InstanceEntry *
+instance_entry_new (const char *id)
+{
+  InstanceEntry *entry;
+  pid_t pid;
+
+  entry = g_new0 (InstanceEntry, 1);
+  entry->instance = flatpak_instance_new_for_id (id);
+  entry->pidfd = -1;
+
+  pid = flatpak_instance_get_pid (entry->instance);
+  if (pid == 0)
+    return entry;
+
+#ifdef SYS_pidfd_open
+  entry->pidfd = syscall (SYS_pidfd_open, pid, 0);
+#else
+  errno = ENOSYS;
+#endif
+
+  if (entry->pidfd == -1)
+    {
+      /* Without pidfds, we fall back to checking the pid every time */
+      if (errno == ESRCH)
+        entry->exited = TRUE;
+      else
+        g_debug ("Can't watch process %d: %s", pid, g_strerror (errno));
+
+      return entry;
+    }
+
+  entry->exit_source = g_unix_fd_source_new (entry->pidfd, G_IO_IN);
+  g_source_set_callback (entry->exit_source,
+                         (GSourceFunc) instance_exited_cb,
+                         entry, NULL);
+  g_source_attach (entry->exit_source, monitor_context);
+
+  return entry;
+}
+
+/* Instances are picked up as soon as their directory is created, and
+ * flatpak may not have written all of their files yet. bwrapinfo.json,
+ * which has the child pid, comes last. */
+static gboolean
+instance_entry_is_complete (InstanceEntry *entry)
+{
+  return flatpak_instance_get_info (entry->instance) != NULL &&
+         flatpak_instance_get_pid (entry->instance) != 0 &&
+         flatpak_instance_get_child_pid (entry->instance) != 0;
+}
+
+static gboolean
+instance_entry_is_running (InstanceEntry *entry)
+{
+  if (entry->exited)
+    return FALSE;
+
+  if (entry->pidfd != -1)
+    return TRUE;
+
+  return flatpak_instance_is_running (entry->instance);
+}
+
+static void
+load_instance (const char *id)
+{
+  g_hash_table_replace (instances, g_strdup (id), instance_entry_new (id));
+}
+
+static void
+load_all_instances (void)
+{
+  g_autoptr(GPtrArray) ids = NULL;
+
+  instances = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                     g_free, instance_entry_free);
+
+  ids = flatpak_instance_get_all_ids ();
+  for (guint i = 0; i < ids->len; i++)
+    load_instance (g_ptr_array_index (ids, i));
+}
+
+static void
+reload_incomplete_instances (void)
+{
+  g_autoptr(GPtrArray) incomplete = g_ptr_array_new_with_free_func (g_free);
+  GHashTableIter iter;
+  InstanceEntry *entry;
+  char *id;
+
+  g_hash_table_iter_init (&iter, instances);
+  while (g_hash_table_iter_next (&iter, (gpointer *)&id, (gpointer *)&entry))
+    {
+      if (!instance_entry_is_complete (entry))
+        g_ptr_array_add (incomplete, g_strdup (id));
+    }
+
+  for (guint i = 0; i < incomplete->len; i++)
+    load_instance (g_ptr_array_index (incomplete, i));
+}
+
+static gboolean
+has_incomplete_instances (void)
+{
+  GHashTableIter iter;
+  InstanceEntry *entry;
+
+  g_hash_table_iter_init (&iter, instances);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&entry))
+    {
+      if (!instance_entry_is_complete (entry))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* The directory monitor doesn't report the files written inside of an
+ * instance directory, so incomplete instances are looked at again a few
+ * times, with increasing delays. */
+static GSource *retry_source; /* only accessed from the monitor thread */
+static guint n_retries;
+
+static gboolean
+retry_incomplete_instances_cb (gpointer data)
+{
+  g_clear_pointer (&retry_source, g_source_unref);
+  queue_check ();
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_incomplete_instances_retry (void)
+{
+  if (retry_source || n_retries >= MAX_INCOMPLETE_RETRIES)
+    return;
+
+  retry_source = g_timeout_source_new (INCOMPLETE_RETRY_DELAY_MS << n_retries);
+  g_source_set_callback (retry_source, retry_incomplete_instances_cb, NULL, NULL);
+  g_source_attach (retry_source, monitor_context);
+
+  n_retries++;
+}
+
+typedef struct {
+  char *id;
+  gboolean removed;
+} InstanceChange;
+
+static void
+instance_change_free (gpointer data)
+{
+  InstanceChange *change = data;
+
+  g_free (change->id);
+  g_free (change);
+}
+
+static gboolean
+instance_changed_cb (gpointer data)
+{
+  InstanceChange *change = data;
+
+  /* Otherwise, it's picked up when all instances are loaded */
+  if (instances)
+    {
+      if (change->removed)
+        {
+          g_hash_table_remove (instances, change->id);
+        }
+      else
+        {
+          load_instance (change->id);
+          n_retries = 0;
+        }
+    }
+
+  queue_check ();
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+grace_period_elapsed_cb (gpointer user_data)
+{
+  InstanceData *idata = user_data;
+
+  g_clear_pointer (&idata->grace_source, g_source_unref);
+  queue_check ();
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 check_background_apps (void)
 {
   g_autoptr(GVariant) perms = NULL;
   g_autoptr(GHashTable) app_states = NULL;
-  g_autoptr(GPtrArray) instances = NULL;
+  GHashTableIter instances_iter;
+  InstanceEntry *entry;
   int i;
   static int stamp;
   g_autoptr(GPtrArray) notifications = NULL;
+  gint64 now;
 
   app_states = get_app_states ();
   if (app_states == NULL)
@@ -518,23 +824,31 @@ check_background_apps (void)
   g_debug ("Checking background permissions");
 
   perms = get_all_permissions ();
-  instances = flatpak_instance_get_all ();
   notifications = g_ptr_array_new ();
+  now = g_get_monotonic_time ();
 
   stamp++;
 
+  if (instances == NULL)
+    load_all_instances ();
+  else
+    reload_incomplete_instances ();
+
+  if (has_incomplete_instances ())
+    queue_incomplete_instances_retry ();
+
   G_LOCK (applications);
-  for (i = 0; i < instances->len; i++)
+  g_hash_table_iter_init (&instances_iter, instances);
+  while (g_hash_table_iter_next (&instances_iter, NULL, (gpointer *)&entry))
     {
-      FlatpakInstance *instance = g_ptr_array_index (instances, i);
+      FlatpakInstance *instance = entry->instance;
       const char *id;
       const char *app_id;
       pid_t child_pid;
       InstanceData *idata;
       const char *state_names[] = { "background", "running", "active" };
-      gboolean is_new = FALSE;
 
-      if (!flatpak_instance_is_running (instance))
+      if (!instance_entry_is_running (entry))
         continue;
 
       id = flatpak_instance_get_id (instance);
@@ -548,11 +862,15 @@ check_background_apps (void)
 
       if (!idata)
         {
-          is_new = TRUE;
           idata = g_new0 (InstanceData, 1);
           idata->instance = g_object_ref (instance);
           g_hash_table_insert (applications, g_strdup (id), idata);
         }
+      else if (idata->instance != instance)
+        {
+          /* The instance was reloaded since */
+          g_set_object (&idata->instance, instance);
+        }
 
       idata->stamp = stamp;
       idata->state = get_one_app_state (app_id, app_states);
@@ -561,28 +879,47 @@ check_background_apps (void)
 
       idata->permission = get_one_permission (app_id, perms);
 
-      /* If the app is not in the list yet, add it,
-       * but don't notify yet - this gives apps some
-       * leeway to get their window up. If it is still
-       * in the background next time around, we'll proceed
-       * to the next step.
+      if (idata->state != BACKGROUND)
+        {
+          idata->background_since = 0;
+          clear_source (&idata->grace_source);
+          continue;
+        }
+
+      if (idata->notified)
+        {
+          g_debug ("Already notified app %s ...skipping\n", app_id);
+          continue;
+        }
+
+      /* If the app just went into the background, don't
+       * notify yet - this gives apps some leeway to get
+       * their window up. If it is still in the background
+       * when the grace period is over, we'll proceed to
+       * the next step.
        */
-      if (idata->state != BACKGROUND || idata->notified || is_new)
+      if (idata->background_since == 0)
         {
-          if (idata->notified)
-            g_debug ("Already notified app %s ...skipping\n", app_id);
-          if (is_new)
-            g_debug ("App %s is new ...skipping\n", app_id);
+          g_debug ("App %s just went into the background ...skipping\n", app_id);
+
+          idata->background_since = now;
+          idata->grace_source = g_timeout_source_new (BACKGROUND_GRACE_PERIOD_MS);
+          g_source_set_callback (idata->grace_source, grace_period_elapsed_cb, idata, NULL);
+          g_source_attach (idata->grace_source, monitor_context);
           continue;
         }
 
+      if (now - idata->background_since < BACKGROUND_GRACE_PERIOD_MS * 1000)
+        continue;
+
       switch (idata->permission)
         {
         case XDP_PERMISSION_NO:
           idata->stamp = 0;
 
           g_debug ("Kill app %s (pid %d)", app_id, child_pid);
-          kill (child_pid, SIGKILL);
+          if (child_pid > 0)
+            kill (child_pid, SIGKILL);
           break;
 
         case XDP_PERMISSION_ASK:
@@ -636,25 +973,23 @@ check_background_apps (void)
   update_background_monitor_properties ();
 }
 
-static GMainContext *monitor_context;
-
 static gpointer
 background_monitor (gpointer data)
 {
+  g_autoptr(GMainLoop) loop = NULL;
+
   applications = g_hash_table_new_full (g_str_hash, g_str_equal,
                                         g_free, instance_data_free);
 
-  while (TRUE)
-    {
-      g_main_context_iteration (monitor_context, TRUE);
-      /* We check twice, to avoid killing unlucky apps hit at a bad time */
-      sleep (5);
-      check_background_apps ();
-      sleep (5);
-      check_background_apps ();
-    }
+  g_main_context_push_thread_default (monitor_context);
+
+  loop = g_main_loop_new (monitor_context, FALSE);
+  g_main_loop_run (loop);
+
+  g_main_context_pop_thread_default (monitor_context);
 
   g_clear_pointer (&applications, g_hash_table_unref);
+  g_clear_pointer (&instances, g_hash_table_unref);
   g_clear_pointer (&monitor_context, g_main_context_unref);
 
   return NULL;
@@ -676,14 +1011,33 @@ static void
 running_apps_changed (gpointer data)
 {
   g_debug ("Running app windows changed, wake up monitor thread");
-  g_main_context_wakeup (monitor_context);
+  g_main_context_invoke (monitor_context, queue_check_cb, NULL);
 }
 
 static void
-instances_changed (gpointer data)
+instances_changed (GFileMonitor      *monitor,
+                   GFile             *file,
+                   GFile             *other_file,
+                   GFileMonitorEvent  event_type,
+                   gpointer           data)
 {
+  g_autofree char *id = g_file_get_basename (file);
+  InstanceChange *change;
+
+  /* Per-app directories never become instances */
+  if (!flatpak_instance_id_is_valid (id))
+    return;
+
   g_debug ("Running instances changed, wake up monitor thread");
-  g_main_context_wakeup (monitor_context);
+
+  change = g_new0 (InstanceChange, 1);
+  change->id = g_steal_pointer (&id);
+  change->removed = event_type == G_FILE_MONITOR_EVENT_DELETED ||
+                    event_type == G_FILE_MONITOR_EVENT_MOVED_OUT;
+
+  g_main_context_invoke_full (monitor_context, G_PRIORITY_DEFAULT,
+                              instance_changed_cb,
+                              change, instance_change_free);
 }
 
 gboolean
@@ -972,7 +1326,7 @@ handle_request_background (XdpDbusBackground *object,
 {
   XdpRequest *request = xdp_request_from_invocation (invocation);
   g_autoptr(GError) error = NULL;
-  g_autoptr(XdpDbusImplRequest) impl_request = NULL;
+  g_autoptr(XdpImplRequest) impl_request = NULL;
   g_autoptr(GTask) task = NULL;
   g_auto(GVariantBuilder) opt_builder =
     G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
@@ -993,17 +1347,7 @@ handle_request_background (XdpDbusBackground *object,
   g_object_set_data_full (G_OBJECT (request), "window", g_strdup (arg_window), g_free);
   g_object_set_data_full (G_OBJECT (request), "options", g_variant_ref (options), (GDestroyNotify)g_variant_unref);
 
-  impl_request =
-    xdp_dbus_impl_request_proxy_new_sync (g_dbus_proxy_get_connection (G_DBUS_PROXY (access_impl)),
-                                          G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
-                                          g_dbus_proxy_get_name (G_DBUS_PROXY (access_impl)),
-                                          request->id,
-                                          NULL, &error);
-  if (!impl_request)
-    {
-      g_dbus_method_invocation_return_gerror (invocation, error);
-      return G_DBUS_METHOD_INVOCATION_HANDLED;
-    }
+  impl_request = xdp_impl_request_new (G_DBUS_PROXY (access_impl), request->id);
 
   xdp_request_set_impl_request (request, impl_request);
   xdp_request_export (request, g_dbus_method_invocation_get_connection (invocation));
@@ -1066,21 +1410,12 @@ handle_set_status_in_thread_func (GTask        *task,
   if (!data)
     {
       g_autoptr(GHashTable) app_states = NULL;
-      g_autoptr(GPtrArray) instances = NULL;
-      FlatpakInstance *instance = NULL;
+      g_autoptr(FlatpakInstance) instance = NULL;
 
-      instances = flatpak_instance_get_all ();
-      for (guint i = 0; i < instances->len; i++)
-        {
-          FlatpakInstance *aux = g_ptr_array_index (instances, i);
-          if (g_strcmp0 (id, flatpak_instance_get_id (aux)) == 0)
-            {
-              instance = aux;
-              break;
-            }
-        }
+      if (id)
+        instance = flatpak_instance_new_for_id (id);
 
-      if (!instance)
+      if (!instance || !flatpak_instance_get_info (instance))
         {
           G_UNLOCK (applications);
           g_task_return_new_error (task,
@@ -94,7 +94,7 @@ query_permission_sync (XdpRequest *request)
       g_autoptr(GVariant) results = NULL;
       g_autoptr(GError) error = NULL;
       g_autoptr(GAppInfo) info = NULL;
-      g_autoptr(XdpDbusImplRequest) impl_request = NULL;
+      g_autoptr(XdpImplRequest) impl_request = NULL;
 
       if (app_id[0] != 0)
         {
@@ -115,13 +115,7 @@ query_permission_sync (XdpRequest *request)
           body = g_strdup (_("An app wants to access camera devices."));
         }
 
-      impl_request = xdp_dbus_impl_request_proxy_new_sync (g_dbus_proxy_get_connection (G_DBUS_PROXY (access_impl)),
-                                                           G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
-                                                           g_dbus_proxy_get_name (G_DBUS_PROXY (access_impl)),
-                                                           request->id,
-                                                           NULL, &error);
-      if (!impl_request)
-        return FALSE;
+      impl_request = xdp_impl_request_new (G_DBUS_PROXY (access_impl), request->id);
 
       xdp_request_set_impl_request (request, impl_request);
 
@@ -447,7 +447,18 @@ flatpak_instance_new (const char *dir)
   return self;
 }
 
-static FlatpakInstance *
+/**
+ * flatpak_instance_new_for_id:
+ * @id: an instance ID
+ *
+ * Gets a FlatpakInstance object for the sandbox with the given ID,
+ * without looking at the other ones.
+ *
+ * If there is no such sandbox, flatpak_instance_get_info() returns %NULL.
+ *
+ * Returns: (transfer full): a #FlatpakInstance
+ */
+FlatpakInstance *
 flatpak_instance_new_for_id (const char *id)
 {
   g_autofree char *dir = NULL;
@@ -457,24 +468,47 @@ flatpak_instance_new_for_id (const char *id)
 }
 
 /**
- * flatpak_instance_get_all:
+ * flatpak_instance_id_is_valid:
+ * @id: the name of a directory in $XDG_RUNTIME_DIR/.flatpak
  *
- * Gets FlatpakInstance objects for all running sandboxes in the current session.
+ * Flatpak keeps per-app directories, named after the app ID, next to the
+ * directories of the sandboxes. Instance IDs are numbers.
  *
- * Returns: (transfer full) (element-type FlatpakInstance): a #GPtrArray of
- *   #FlatpakInstance objects
+ * Returns: %TRUE if @id can be the ID of a sandbox
+ */
+gboolean
+flatpak_instance_id_is_valid (const char *id)
+{
+  if (id == NULL || *id == '\0')
+    return FALSE;
+
+  for (const char *p = id; *p != '\0'; p++)
+    {
+      if (!g_ascii_isdigit (*p))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/**
+ * flatpak_instance_get_all_ids:
  *
- * Since: 1.1
+ * Gets the IDs of all sandboxes in the current session, without loading
+ * them. This includes sandboxes that exited, but whose directory was not
+ * removed yet.
+ *
+ * Returns: (transfer full) (element-type utf8): a #GPtrArray of instance IDs
  */
 GPtrArray *
-flatpak_instance_get_all (void)
+flatpak_instance_get_all_ids (void)
 {
-  g_autoptr(GPtrArray) instances = NULL;
+  g_autoptr(GPtrArray) ids = NULL;
   g_autofree char *base_dir = NULL;
   g_autoptr(GFile) file = NULL;
   g_autoptr(GFileEnumerator) iter = NULL;
 
-  instances = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+  ids = g_ptr_array_new_with_free_func (g_free);
   base_dir = g_build_filename (g_get_user_runtime_dir (), ".flatpak", NULL);
   file = g_file_new_for_path (base_dir);
   iter = g_file_enumerate_children (file,
@@ -484,7 +518,7 @@ flatpak_instance_get_all (void)
                                     NULL,
                                     NULL);
   if (!iter)
-    return g_steal_pointer (&instances);
+    return g_steal_pointer (&ids);
 
   while (TRUE)
     {
@@ -496,10 +530,36 @@ flatpak_instance_get_all (void)
       if (!info)
         break;
 
-      if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
-        g_ptr_array_add (instances, flatpak_instance_new_for_id (g_file_info_get_name (info)));
+      if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY &&
+          flatpak_instance_id_is_valid (g_file_info_get_name (info)))
+        g_ptr_array_add (ids, g_strdup (g_file_info_get_name (info)));
     }
 
+  return g_steal_pointer (&ids);
+}
+
+/**
+ * flatpak_instance_get_all:
+ *
+ * Gets FlatpakInstance objects for all running sandboxes in the current session.
+ *
+ * Returns: (transfer full) (element-type FlatpakInstance): a #GPtrArray of
+ *   #FlatpakInstance objects
+ *
+ * Since: 1.1
+ */
+GPtrArray *
+flatpak_instance_get_all (void)
+{
+  g_autoptr(GPtrArray) ids = NULL;
+  g_autoptr(GPtrArray) instances = NULL;
+
+  ids = flatpak_instance_get_all_ids ();
+  instances = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+  for (guint i = 0; i < ids->len; i++)
+    g_ptr_array_add (instances, flatpak_instance_new_for_id (g_ptr_array_index (ids, i)));
+
   return g_steal_pointer (&instances);
 }
 
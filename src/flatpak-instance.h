@@ -47,6 +47,9 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC (FlatpakInstance, g_object_unref)
 #endif
 
 GPtrArray *  flatpak_instance_get_all (void);
+GPtrArray *  flatpak_instance_get_all_ids (void);
+FlatpakInstance * flatpak_instance_new_for_id (const char *id);
+gboolean     flatpak_instance_id_is_valid (const char *id);
 
 const char * flatpak_instance_get_id (FlatpakInstance *self);
 const char * flatpak_instance_get_app (FlatpakInstance *self);
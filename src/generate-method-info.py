@@ -12,7 +12,7 @@ def cbool(b: bool):
     return "TRUE" if b else "FALSE"
 
 
-def handle_interface(interface: ElementTree.Element):
+def handle_interface(interface: ElementTree.Element, methods: list):
     intf_name = interface.attrib["name"]
     for method in interface.iter("method"):
         method_name = method.attrib["name"]
@@ -33,19 +33,20 @@ def handle_interface(interface: ElementTree.Element):
             if arg_name == "options" and arg_type == "a{sv}" and arg_direction == "in":
                 option_arg = pos
 
-        method_name = quote(method_name)
-        iname = quote(intf_name)
-        print(
-            f"  {{ .interface = {iname:40s}, .method = {method_name:32s}, .uses_request = {cbool(uses_requests)}, .option_arg = {option_arg:2d}, }},"
-        )
+        methods.append((intf_name, method_name, uses_requests, option_arg))
 
 
-def parse_portal_xml(filename: str):
+def parse_portal_xml(filename: str, methods: list):
     tree = ElementTree.parse(filename)
     root = tree.getroot()
 
     for interface in root.iter("interface"):
-        handle_interface(interface)
+        handle_interface(interface, methods)
+
+
+def bytes_key(s: str):
+    # Sort the same way strcmp() compares
+    return s.encode("utf-8")
 
 
 if __name__ == "__main__":
@@ -57,14 +58,38 @@ if __name__ == "__main__":
     print('#include "glib.h"')
     print('#include "xdp-method-info.h"')
     print("")
-    print("static const XdpMethodInfo method_info[] = {")
-
+    methods = []
     for file in args.file:
-        parse_portal_xml(file)
+        parse_portal_xml(file, methods)
+
+    # Sorted by interface, then method, so that lookups can bisect
+    methods.sort(key=lambda m: (bytes_key(m[0]), bytes_key(m[1])))
+
+    interfaces = []
+    for idx, (intf_name, method_name, uses_requests, option_arg) in enumerate(methods):
+        if interfaces and interfaces[-1][0] == intf_name:
+            interfaces[-1][2] += 1
+        else:
+            interfaces.append([intf_name, idx, 1])
 
+    print("static const XdpMethodInfo method_info[] = {")
+    for intf_name, method_name, uses_requests, option_arg in methods:
+        method_name = quote(method_name)
+        iname = quote(intf_name)
+        print(
+            f"  {{ .interface = {iname:40s}, .method = {method_name:32s}, .uses_request = {cbool(uses_requests)}, .option_arg = {option_arg:2d}, }},"
+        )
     print("  { .interface = NULL },")
     print("};")
     print("")
+    print("static const XdpMethodInterfaceInfo interface_info[] = {")
+    for intf_name, first, n_methods in interfaces:
+        iname = quote(intf_name)
+        print(
+            f"  {{ .interface = {iname:40s}, .first = {first:3d}, .n_methods = {n_methods:2d}, }},"
+        )
+    print("};")
+    print("")
     print(
         "const XdpMethodInfo *xdp_method_info_get_all (void) { return method_info; };"
     )
@@ -72,3 +97,11 @@ if __name__ == "__main__":
     print(
         "unsigned int xdp_method_info_get_count (void) { return G_N_ELEMENTS(method_info) - 1; };"
     )
+    print("")
+    print(
+        "const XdpMethodInterfaceInfo *xdp_method_info_get_interfaces (void) { return interface_info; };"
+    )
+    print("")
+    print(
+        "unsigned int xdp_method_info_get_n_interfaces (void) { return G_N_ELEMENTS(interface_info); };"
+    )
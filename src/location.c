@@ -22,6 +22,7 @@
 
 #include "config.h"
 
+#include <math.h>
 #include <string.h>
 
 #include <glib/gi18n.h>
@@ -62,6 +63,9 @@ typedef struct
   guint accuracy;
 
   GeoclueClient *client;
+
+  guint64 location_serial;
+  GVariant *last_location;
 } LocationSession;
 
 typedef struct
@@ -112,6 +116,7 @@ location_session_finalize (GObject *object)
   LocationSession *loc_session = LOCATION_SESSION (object);
 
   g_clear_object (&loc_session->client);
+  g_clear_pointer (&loc_session->last_location, g_variant_unref);
 
   G_OBJECT_CLASS (location_session_parent_class)->finalize (object);
 }
@@ -152,30 +157,92 @@ location_session_new (GVariant *options,
 
 /*** GeoClue integration ***/
 
+#define EARTH_RADIUS_METERS 6372795.0
+
+typedef struct
+{
+  XdpSession *session;
+  guint64 serial;
+} LocationUpdate;
+
 static void
-location_updated (GeoclueClient *client,
-                  const char *old_location,
-                  const char *new_location,
-                  gpointer data)
+location_update_free (LocationUpdate *update)
+{
+  g_clear_object (&update->session);
+  g_free (update);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (LocationUpdate, location_update_free)
+
+static gboolean
+lookup_coordinates (GVariant *location,
+                    double   *latitude,
+                    double   *longitude)
+{
+  return g_variant_lookup (location, "Latitude", "d", latitude) &&
+         g_variant_lookup (location, "Longitude", "d", longitude);
+}
+
+/* Great-circle distance, using the haversine formula */
+static double
+distance_between (double latitude1,
+                  double longitude1,
+                  double latitude2,
+                  double longitude2)
 {
-  XdpSession *session = data;
+  double dlatitude = (latitude2 - latitude1) * G_PI / 180.0;
+  double dlongitude = (longitude2 - longitude1) * G_PI / 180.0;
+  double a;
+
+  a = sin (dlatitude / 2) * sin (dlatitude / 2) +
+      cos (latitude1 * G_PI / 180.0) * cos (latitude2 * G_PI / 180.0) *
+      sin (dlongitude / 2) * sin (dlongitude / 2);
+
+  return 2 * EARTH_RADIUS_METERS * asin (sqrt (MIN (a, 1.0)));
+}
+
+/* GeoClue applies the thresholds of the session, but it can report the
+ * same fix again, and the distance is checked here against the last fix
+ * that was actually sent, since fixes can be dropped while fetching them.
+ * The time threshold is left to GeoClue: it applies it with the timestamps
+ * of the fixes, while here, it would depend on how long it took to fetch
+ * them, and GeoClue doesn't resend a fix that is dropped. */
+static gboolean
+location_session_wants_location (LocationSession *loc_session,
+                                 GVariant        *location)
+{
+  double latitude, longitude;
+  double last_latitude, last_longitude;
+
+  if (loc_session->last_location == NULL)
+    return TRUE;
+
+  if (g_variant_equal (location, loc_session->last_location))
+    return FALSE;
+
+  if (loc_session->distance_threshold > 0 &&
+      lookup_coordinates (location, &latitude, &longitude) &&
+      lookup_coordinates (loc_session->last_location, &last_latitude, &last_longitude) &&
+      distance_between (last_latitude, last_longitude, latitude, longitude) <
+      loc_session->distance_threshold)
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+got_location_properties (GObject      *source_object,
+                         GAsyncResult *result,
+                         gpointer      data)
+{
+  g_autoptr(LocationUpdate) update = data;
+  XdpSession *session = update->session;
+  LocationSession *loc_session = LOCATION_SESSION (session);
   g_autoptr(GVariant) ret = NULL;
   g_autoptr(GError) error = NULL;
   g_autoptr(GVariant) dict = NULL;
 
-  g_debug ("GeoClue client ::LocationUpdated %s -> %s\n",  old_location, new_location);
-
-  if (strcmp (new_location, "/") == 0)
-    return;
-
-  ret = g_dbus_connection_call_sync (g_dbus_proxy_get_connection (G_DBUS_PROXY (client)),
-                                     "org.freedesktop.GeoClue2",
-                                     new_location,
-                                     "org.freedesktop.DBus.Properties",
-                                     "GetAll",
-                                     g_variant_new ("(s)", "org.freedesktop.GeoClue2.Location"),
-                                     G_VARIANT_TYPE ("(a{sv})"),
-                                     0, -1, NULL, &error);
+  ret = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object), result, &error);
   if (ret == NULL)
     {
       g_warning ("Failed to get location properties: %s", error->message);
@@ -184,6 +251,24 @@ location_updated (GeoclueClient *client,
 
   g_variant_get (ret, "(@a{sv})", &dict);
 
+  SESSION_AUTOLOCK (session);
+
+  if (loc_session->state == LOCATION_SESSION_STATE_CLOSED)
+    return;
+
+  /* A newer location came in while this one was being fetched */
+  if (update->serial != loc_session->location_serial)
+    return;
+
+  if (!location_session_wants_location (loc_session, dict))
+    {
+      g_debug ("location session '%s': Dropping location within thresholds", session->id);
+      return;
+    }
+
+  g_clear_pointer (&loc_session->last_location, g_variant_unref);
+  loc_session->last_location = g_variant_ref (dict);
+
   if (opt_verbose)
     {
       g_autofree char *a = g_variant_print (dict, FALSE);
@@ -202,6 +287,43 @@ location_updated (GeoclueClient *client,
     }
 }
 
+static void
+location_updated (GeoclueClient *client,
+                  const char *old_location,
+                  const char *new_location,
+                  gpointer data)
+{
+  LocationSession *loc_session = data;
+  XdpSession *session = XDP_SESSION (loc_session);
+  LocationUpdate *update;
+
+  g_debug ("GeoClue client ::LocationUpdated %s -> %s\n",  old_location, new_location);
+
+  if (strcmp (new_location, "/") == 0)
+    return;
+
+  SESSION_AUTOLOCK (session);
+
+  /* Locations are immutable, so their properties are fetched only once,
+   * without blocking the thread that dispatches GeoClue signals */
+  update = g_new0 (LocationUpdate, 1);
+  update->session = g_object_ref (session);
+  update->serial = ++loc_session->location_serial;
+
+  g_dbus_connection_call (g_dbus_proxy_get_connection (G_DBUS_PROXY (client)),
+                          "org.freedesktop.GeoClue2",
+                          new_location,
+                          "org.freedesktop.DBus.Properties",
+                          "GetAll",
+                          g_variant_new ("(s)", "org.freedesktop.GeoClue2.Location"),
+                          G_VARIANT_TYPE ("(a{sv})"),
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1,
+                          NULL,
+                          got_location_properties,
+                          update);
+}
+
 static gboolean
 location_session_start (LocationSession *loc_session)
 {
@@ -524,7 +646,7 @@ handle_start_in_thread_func (GTask *task,
     {
       guint access_response = 2;
       g_autoptr(GVariant) access_results = NULL;
-      g_autoptr(XdpDbusImplRequest) impl_request = NULL;
+      g_autoptr(XdpImplRequest) impl_request = NULL;
       g_auto(GVariantBuilder) access_opt_builder =
         G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
       g_autofree char *app_id = NULL;
@@ -532,11 +654,7 @@ handle_start_in_thread_func (GTask *task,
       g_autofree char *subtitle = NULL;
       const char *body;
 
-      impl_request = xdp_dbus_impl_request_proxy_new_sync (g_dbus_proxy_get_connection (G_DBUS_PROXY (access_impl)),
-                                                           G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
-                                                           g_dbus_proxy_get_name (G_DBUS_PROXY (access_impl)),
-                                                           request->id,
-                                                           NULL, NULL);
+      impl_request = xdp_impl_request_new (G_DBUS_PROXY (access_impl), request->id);
 
       xdp_request_set_impl_request (request, impl_request);
 
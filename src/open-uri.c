@@ -56,6 +56,9 @@
 
 #define DEFAULT_THRESHOLD 3
 
+/* Entries are dropped all at once when a cache grows beyond this */
+#define MAX_CACHE_ENTRIES 128
+
 typedef struct _OpenURI OpenURI;
 
 typedef struct _OpenURIClass OpenURIClass;
@@ -82,6 +85,32 @@ static OpenURI *open_uri;
 static GAppInfoMonitor *monitor;
 static XdpDbusImplLockdown *lockdown;
 
+/* Resolving handlers and looking up the previous choices is done on every
+ * open, and is mostly the same for every file of a type. Handlers are
+ * cached until the GAppInfoMonitor reports a change, and the entries of
+ * the permission store table until it emits Changed for them.
+ */
+typedef struct
+{
+  char *default_app;
+  GStrv choices;
+  guint n_choices;
+} CachedChoices;
+
+typedef struct
+{
+  GVariant *permissions;
+  GVariant *data;
+} CachedChoicePermissions;
+
+/* Protects the caches and their generations */
+G_LOCK_DEFINE_STATIC (caches);
+static GHashTable *choices_cache; /* content type → CachedChoices */
+static GHashTable *apps_cache; /* app id → exists */
+static guint apps_generation;
+static GHashTable *permissions_cache; /* content type → CachedChoicePermissions */
+static guint permissions_generation;
+
 GType open_uri_get_type (void) G_GNUC_CONST;
 static void open_uri_iface_init (XdpDbusOpenURIIface *iface);
 
@@ -89,6 +118,33 @@ G_DEFINE_TYPE_WITH_CODE (OpenURI, open_uri, XDP_DBUS_TYPE_OPEN_URI_SKELETON,
                          G_IMPLEMENT_INTERFACE (XDP_DBUS_TYPE_OPEN_URI,
                                                 open_uri_iface_init));
 
+static void
+cached_choices_free (CachedChoices *cached)
+{
+  g_free (cached->default_app);
+  g_strfreev (cached->choices);
+  g_free (cached);
+}
+
+static void
+cached_choice_permissions_free (CachedChoicePermissions *cached)
+{
+  g_clear_pointer (&cached->permissions, g_variant_unref);
+  g_clear_pointer (&cached->data, g_variant_unref);
+  g_free (cached);
+}
+
+static void
+cache_insert (GHashTable *cache,
+              const char *key,
+              gpointer    value)
+{
+  if (g_hash_table_size (cache) >= MAX_CACHE_ENTRIES)
+    g_hash_table_remove_all (cache);
+
+  g_hash_table_replace (cache, g_strdup (key), value);
+}
+
 static void
 parse_permissions (const char **permissions,
                    char **app_id,
@@ -118,6 +174,105 @@ parse_permissions (const char **permissions,
   *app_threshold = perms_threshold;
 }
 
+static void
+lookup_choice_permissions (const char  *content_type,
+                           GVariant   **out_perms,
+                           GVariant   **out_data)
+{
+  g_autoptr(GError) error = NULL;
+  CachedChoicePermissions *cached;
+  guint generation;
+
+  g_return_if_fail (content_type != NULL);
+
+  G_LOCK (caches);
+
+  cached = g_hash_table_lookup (permissions_cache, content_type);
+  if (cached)
+    {
+      if (cached->permissions)
+        *out_perms = g_variant_ref (cached->permissions);
+      if (cached->data)
+        *out_data = g_variant_ref (cached->data);
+    }
+  generation = permissions_generation;
+
+  G_UNLOCK (caches);
+
+  if (cached)
+    return;
+
+  if (!xdp_dbus_impl_permission_store_call_lookup_sync (xdp_get_permission_store (),
+                                                        PERMISSION_TABLE,
+                                                        content_type,
+                                                        out_perms,
+                                                        out_data,
+                                                        NULL,
+                                                        &error))
+    {
+      g_dbus_error_strip_remote_error (error);
+      /* Not finding an entry for the content type in the permission store is perfectly ok */
+      if (!g_error_matches (error, XDG_DESKTOP_PORTAL_ERROR, XDG_DESKTOP_PORTAL_ERROR_NOT_FOUND))
+        {
+          g_warning ("Unable to retrieve info for '%s' in the %s table of the permission store: %s",
+                     content_type, PERMISSION_TABLE, error->message);
+          return;
+        }
+    }
+
+  G_LOCK (caches);
+
+  /* Don't cache what might have been read before a change */
+  if (generation == permissions_generation)
+    {
+      cached = g_new0 (CachedChoicePermissions, 1);
+      if (*out_perms)
+        cached->permissions = g_variant_ref (*out_perms);
+      if (*out_data)
+        cached->data = g_variant_ref (*out_data);
+
+      cache_insert (permissions_cache, content_type, cached);
+    }
+
+  G_UNLOCK (caches);
+}
+
+static void
+invalidate_choice_permissions (const char *content_type)
+{
+  G_LOCK (caches);
+
+  if (content_type)
+    g_hash_table_remove (permissions_cache, content_type);
+  else
+    g_hash_table_remove_all (permissions_cache);
+  permissions_generation++;
+
+  G_UNLOCK (caches);
+}
+
+static void
+permission_store_changed (XdpDbusImplPermissionStore *store,
+                          const char                 *table,
+                          const char                 *id,
+                          gboolean                    deleted,
+                          GVariant                   *data,
+                          GVariant                   *perms,
+                          gpointer                    user_data)
+{
+  if (g_strcmp0 (table, PERMISSION_TABLE) == 0)
+    invalidate_choice_permissions (id);
+}
+
+static void
+permission_store_owner_changed (GObject    *object,
+                                GParamSpec *pspec,
+                                gpointer    user_data)
+{
+  /* A new permission store may have different contents */
+  invalidate_choice_permissions (NULL);
+}
+
 static gboolean
 get_latest_choice_info (const char *app_id,
                         const char *content_type,
@@ -130,25 +285,10 @@ get_latest_choice_info (const char *app_id,
   int choice_count = 0;
   int choice_threshold = DEFAULT_THRESHOLD;
   gboolean ask = FALSE;
-  g_autoptr(GError) error = NULL;
   g_autoptr(GVariant) out_perms = NULL;
   g_autoptr(GVariant) out_data = NULL;
 
-  if (!xdp_dbus_impl_permission_store_call_lookup_sync (xdp_get_permission_store (),
-                                                        PERMISSION_TABLE,
-                                                        content_type,
-                                                        &out_perms,
-                                                        &out_data,
-                                                        NULL,
-                                                        &error))
-    {
-      g_dbus_error_strip_remote_error (error);
-      /* Not finding an entry for the content type in the permission store is perfectly ok */
-      if (!g_error_matches (error, XDG_DESKTOP_PORTAL_ERROR, XDG_DESKTOP_PORTAL_ERROR_NOT_FOUND))
-        g_warning ("Unable to retrieve info for '%s' in the %s table of the permission store: %s",
-                   content_type, PERMISSION_TABLE, error->message);
-      g_clear_error (&error);
-    }
+  lookup_choice_permissions (content_type, &out_perms, &out_data);
 
   if (out_data != NULL)
     {
@@ -342,6 +482,9 @@ update_permissions_store (const char *app_id,
       g_warning ("Error updating permission store: %s", error->message);
       g_clear_error (&error);
     }
+
+  /* Changed is emitted as well, but it may arrive after the next open */
+  invalidate_choice_permissions (content_type);
 }
 
 static void
@@ -502,11 +645,11 @@ should_use_default_app (const char *scheme,
 }
 
 static void
-find_recommended_choices (const char *scheme,
-                          const char *content_type,
-                          char **default_app,
-                          GStrv *choices,
-                          guint *choices_len)
+lookup_recommended_choices (const char *scheme,
+                            const char *content_type,
+                            char **default_app,
+                            GStrv *choices,
+                            guint *choices_len)
 {
   g_autoptr(GAppInfo) info = NULL;
   g_autolist(GAppInfo) infos = NULL;
@@ -550,6 +693,71 @@ find_recommended_choices (const char *scheme,
   *choices_len = n_choices;
 }
 
+static void
+find_recommended_choices (const char *scheme,
+                          const char *content_type,
+                          char **default_app,
+                          GStrv *choices,
+                          guint *choices_len)
+{
+  CachedChoices *cached;
+  guint generation;
+
+  if (content_type == NULL)
+    {
+      lookup_recommended_choices (scheme, content_type, default_app, choices, choices_len);
+      return;
+    }
+
+  G_LOCK (caches);
+
+  cached = g_hash_table_lookup (choices_cache, content_type);
+  if (cached)
+    {
+      *default_app = g_strdup (cached->default_app);
+      *choices = g_strdupv (cached->choices);
+      *choices_len = cached->n_choices;
+    }
+  generation = apps_generation;
+
+  G_UNLOCK (caches);
+
+  if (cached)
+    {
+      g_debug ("Using cached handlers for %s, %s", scheme, content_type);
+      return;
+    }
+
+  lookup_recommended_choices (scheme, content_type, default_app, choices, choices_len);
+
+  G_LOCK (caches);
+
+  if (generation == apps_generation)
+    {
+      cached = g_new0 (CachedChoices, 1);
+      cached->default_app = g_strdup (*default_app);
+      cached->choices = g_strdupv (*choices);
+      cached->n_choices = *choices_len;
+
+      cache_insert (choices_cache, content_type, cached);
+    }
+
+  G_UNLOCK (caches);
+}
+
+static void
+invalidate_choices (GAppInfoMonitor *monitor,
+                    gpointer         user_data)
+{
+  G_LOCK (caches);
+
+  g_hash_table_remove_all (choices_cache);
+  g_hash_table_remove_all (apps_cache);
+  apps_generation++;
+
+  G_UNLOCK (caches);
+}
+
 static void
 app_info_changed (GAppInfoMonitor *monitor,
                   XdpRequest *request)
@@ -577,11 +785,32 @@ app_exists (const char *app_id)
 {
   g_autoptr(GDesktopAppInfo) info = NULL;
   g_autofree gchar *with_desktop = NULL;
+  gpointer exists;
+  guint generation;
 
   g_return_val_if_fail (app_id != NULL, FALSE);
 
+  G_LOCK (caches);
+
+  if (g_hash_table_lookup_extended (apps_cache, app_id, NULL, &exists))
+    {
+      G_UNLOCK (caches);
+      return GPOINTER_TO_INT (exists);
+    }
+  generation = apps_generation;
+
+  G_UNLOCK (caches);
+
   with_desktop = g_strconcat (app_id, ".desktop", NULL);
   info = g_desktop_app_info_new (with_desktop);
+
+  G_LOCK (caches);
+
+  if (generation == apps_generation)
+    cache_insert (apps_cache, app_id, GINT_TO_POINTER (info != NULL));
+
+  G_UNLOCK (caches);
+
   return (info != NULL);
 }
 
@@ -596,7 +825,7 @@ handle_open_in_thread_func (GTask *task,
   const char *app_id = xdp_app_info_get_id (request->app_info);
   const char *activation_token;
   g_autofree char *uri = NULL;
-  g_autoptr(XdpDbusImplRequest) impl_request = NULL;
+  g_autoptr(XdpImplRequest) impl_request = NULL;
   g_autofree char *default_app = NULL;
   g_auto(GStrv) choices = NULL;
   guint n_choices;
@@ -892,12 +1121,7 @@ handle_open_in_thread_func (GTask *task,
   if (activation_token)
     g_variant_builder_add (&opts_builder, "{sv}", "activation_token", g_variant_new_string (activation_token));
 
-  impl_request =
-    xdp_dbus_impl_request_proxy_new_sync (g_dbus_proxy_get_connection (G_DBUS_PROXY (impl)),
-                                          G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
-                                          g_dbus_proxy_get_name (G_DBUS_PROXY (impl)),
-                                          request->id,
-                                          NULL, NULL);
+  impl_request = xdp_impl_request_new (G_DBUS_PROXY (impl), request->id);
 
   xdp_request_set_impl_request (request, impl_request);
 
@@ -1168,6 +1392,18 @@ open_uri_create (GDBusConnection *connection,
 
   monitor = g_app_info_monitor_get ();
 
+  choices_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, (GDestroyNotify) cached_choices_free);
+  apps_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  permissions_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             g_free, (GDestroyNotify) cached_choice_permissions_free);
+
+  g_signal_connect (monitor, "changed", G_CALLBACK (invalidate_choices), NULL);
+  g_signal_connect (xdp_get_permission_store (), "changed",
+                    G_CALLBACK (permission_store_changed), NULL);
+  g_signal_connect (xdp_get_permission_store (), "notify::g-name-owner",
+                    G_CALLBACK (permission_store_owner_changed), NULL);
+
   return G_DBUS_INTERFACE_SKELETON (open_uri);
 }
 
@@ -34,11 +34,32 @@
 typedef struct _ProxyResolver ProxyResolver;
 typedef struct _ProxyResolverClass ProxyResolverClass;
 
+/* Lookups can take long, e.g. when a PAC file is involved, and apps tend
+ * to look up the same hosts over and over, for every connection. Results
+ * are kept for a while per scheme, host and port, and lookups for the
+ * same key share a single call to the resolver. */
+#define LOOKUP_CACHE_TTL_SECONDS 60
+#define LOOKUP_CACHE_MAX_ENTRIES 256
+
+static const char * const proxy_schemas[] = {
+  "org.gnome.system.proxy",
+  "org.gnome.system.proxy.http",
+  "org.gnome.system.proxy.https",
+  "org.gnome.system.proxy.ftp",
+  "org.gnome.system.proxy.socks",
+};
+
 struct _ProxyResolver
 {
   XdpDbusProxyResolverSkeleton parent_instance;
 
   GProxyResolver *resolver;
+
+  GHashTable *cache; /* key → CachedLookup */
+  GHashTable *pending; /* key → GPtrArray of GDBusMethodInvocation */
+  guint generation;
+
+  GPtrArray *proxy_settings;
 };
 
 struct _ProxyResolverClass
@@ -56,6 +77,195 @@ G_DEFINE_TYPE_WITH_CODE (ProxyResolver, proxy_resolver,
                          G_IMPLEMENT_INTERFACE (XDP_DBUS_TYPE_PROXY_RESOLVER,
                                                 proxy_resolver_iface_init));
 
+/* Protects the cache and pending lookups */
+G_LOCK_DEFINE_STATIC (lookups);
+
+typedef struct
+{
+  GStrv proxies;
+  gint64 expires;
+} CachedLookup;
+
+typedef struct
+{
+  ProxyResolver *resolver;
+  char *key;
+  guint generation;
+} PendingLookup;
+
+static void
+cached_lookup_free (CachedLookup *cached)
+{
+  g_strfreev (cached->proxies);
+  g_free (cached);
+}
+
+static void
+pending_lookup_free (PendingLookup *lookup)
+{
+  g_free (lookup->key);
+  g_free (lookup);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PendingLookup, pending_lookup_free)
+
+static char *
+get_lookup_key (const char *uri)
+{
+  g_autoptr(GUri) parsed = NULL;
+  g_autofree char *host = NULL;
+
+  parsed = g_uri_parse (uri, G_URI_FLAGS_NONE, NULL);
+  if (!parsed || !g_uri_get_host (parsed))
+    return g_strdup (uri);
+
+  host = g_ascii_strdown (g_uri_get_host (parsed), -1);
+
+  return g_strdup_printf ("%s://%s:%d",
+                          g_uri_get_scheme (parsed), host, g_uri_get_port (parsed));
+}
+
+static void
+cache_lookup (ProxyResolver *resolver,
+              const char    *key,
+              char         **proxies)
+{
+  CachedLookup *cached;
+  gint64 now = g_get_monotonic_time ();
+
+  if (g_hash_table_size (resolver->cache) >= LOOKUP_CACHE_MAX_ENTRIES)
+    {
+      GHashTableIter iter;
+
+      g_hash_table_iter_init (&iter, resolver->cache);
+      while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &cached))
+        {
+          if (cached->expires <= now)
+            g_hash_table_iter_remove (&iter);
+        }
+
+      if (g_hash_table_size (resolver->cache) >= LOOKUP_CACHE_MAX_ENTRIES)
+        g_hash_table_remove_all (resolver->cache);
+    }
+
+  cached = g_new0 (CachedLookup, 1);
+  cached->proxies = g_strdupv (proxies);
+  cached->expires = now + LOOKUP_CACHE_TTL_SECONDS * G_USEC_PER_SEC;
+
+  g_hash_table_replace (resolver->cache, g_strdup (key), cached);
+}
+
+static void
+lookup_done (GObject      *source_object,
+             GAsyncResult *result,
+             gpointer      data)
+{
+  g_autoptr(PendingLookup) lookup = data;
+  ProxyResolver *resolver = lookup->resolver;
+  g_autoptr(GPtrArray) invocations = NULL;
+  g_autoptr(GError) error = NULL;
+  g_auto(GStrv) proxies = NULL;
+
+  proxies = g_proxy_resolver_lookup_finish (G_PROXY_RESOLVER (source_object),
+                                            result, &error);
+
+  G_LOCK (lookups);
+
+  if (!g_hash_table_steal_extended (resolver->pending, lookup->key,
+                                    NULL, (gpointer *) &invocations))
+    g_assert_not_reached ();
+
+  /* Proxy settings or the network changed while looking up */
+  if (proxies && lookup->generation == resolver->generation)
+    cache_lookup (resolver, lookup->key, proxies);
+
+  G_UNLOCK (lookups);
+
+  for (size_t i = 0; i < invocations->len; i++)
+    {
+      GDBusMethodInvocation *invocation = g_ptr_array_index (invocations, i);
+
+      if (proxies)
+        g_dbus_method_invocation_return_value (invocation,
+                                               g_variant_new ("(^as)", proxies));
+      else
+        g_dbus_method_invocation_return_gerror (invocation, error);
+    }
+}
+
+static void
+lookup_proxies (ProxyResolver         *resolver,
+                GDBusMethodInvocation *invocation,
+                const char            *uri)
+{
+  g_autofree char *key = NULL;
+  PendingLookup *lookup;
+  CachedLookup *cached;
+  GPtrArray *invocations;
+
+  key = get_lookup_key (uri);
+
+  G_LOCK (lookups);
+
+  cached = g_hash_table_lookup (resolver->cache, key);
+  if (cached && cached->expires > g_get_monotonic_time ())
+    {
+      GVariant *ret = g_variant_new ("(^as)", cached->proxies);
+
+      G_UNLOCK (lookups);
+
+      g_dbus_method_invocation_return_value (invocation, ret);
+      return;
+    }
+
+  /* The invocations are returned once the lookup in flight is done */
+  invocations = g_hash_table_lookup (resolver->pending, key);
+  if (invocations)
+    {
+      g_ptr_array_add (invocations, invocation);
+      G_UNLOCK (lookups);
+      return;
+    }
+
+  invocations = g_ptr_array_new ();
+  g_ptr_array_add (invocations, invocation);
+  g_hash_table_insert (resolver->pending, g_strdup (key), invocations);
+
+  lookup = g_new0 (PendingLookup, 1);
+  lookup->resolver = resolver;
+  lookup->key = g_steal_pointer (&key);
+  lookup->generation = resolver->generation;
+
+  G_UNLOCK (lookups);
+
+  g_proxy_resolver_lookup_async (resolver->resolver, uri, NULL, lookup_done, lookup);
+}
+
+static void
+invalidate_lookups (ProxyResolver *resolver)
+{
+  G_LOCK (lookups);
+  g_hash_table_remove_all (resolver->cache);
+  resolver->generation++;
+  G_UNLOCK (lookups);
+}
+
+static void
+network_changed_cb (GNetworkMonitor *monitor,
+                    gboolean         available,
+                    ProxyResolver   *resolver)
+{
+  invalidate_lookups (resolver);
+}
+
+static void
+proxy_settings_changed_cb (GSettings     *settings,
+                           const char    *key,
+                           ProxyResolver *resolver)
+{
+  invalidate_lookups (resolver);
+}
+
 static gboolean
 proxy_resolver_handle_lookup (XdpDbusProxyResolver *object,
                               GDBusMethodInvocation *invocation,
@@ -73,15 +283,7 @@ proxy_resolver_handle_lookup (XdpDbusProxyResolver *object,
     }
   else
     {
-      g_auto (GStrv) proxies = NULL;
-      g_autoptr (GError) error = NULL;
-
-      proxies = g_proxy_resolver_lookup (resolver->resolver, arg_uri, NULL, &error);
-      if (!proxies)
-        g_dbus_method_invocation_take_error (invocation, g_steal_pointer (&error));
-      else
-        g_dbus_method_invocation_return_value (invocation,
-                                               g_variant_new ("(^as)", proxies));
+      lookup_proxies (resolver, invocation, arg_uri);
     }
 
   return G_DBUS_METHOD_INVOCATION_HANDLED;
@@ -96,7 +298,34 @@ proxy_resolver_iface_init (XdpDbusProxyResolverIface *iface)
 static void
 proxy_resolver_init (ProxyResolver *resolver)
 {
+  GSettingsSchemaSource *schema_source;
+
   resolver->resolver = g_proxy_resolver_get_default ();
+  resolver->cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, (GDestroyNotify) cached_lookup_free);
+  resolver->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  g_signal_connect_object (g_network_monitor_get_default (), "network-changed",
+                           G_CALLBACK (network_changed_cb), resolver, 0);
+
+  /* The default resolver follows the GNOME proxy settings, if present */
+  resolver->proxy_settings = g_ptr_array_new_with_free_func (g_object_unref);
+  schema_source = g_settings_schema_source_get_default ();
+
+  for (size_t i = 0; schema_source && i < G_N_ELEMENTS (proxy_schemas); i++)
+    {
+      g_autoptr(GSettingsSchema) schema = NULL;
+      GSettings *settings;
+
+      schema = g_settings_schema_source_lookup (schema_source, proxy_schemas[i], TRUE);
+      if (!schema)
+        continue;
+
+      settings = g_settings_new_full (schema, NULL, NULL);
+      g_signal_connect (settings, "changed",
+                        G_CALLBACK (proxy_settings_changed_cb), resolver);
+      g_ptr_array_add (resolver->proxy_settings, settings);
+    }
 
   xdp_dbus_proxy_resolver_set_version (XDP_DBUS_PROXY_RESOLVER (resolver), 1);
 }
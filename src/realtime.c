@@ -35,6 +35,10 @@
 #define PERMISSION_TABLE "realtime"
 #define PERMISSION_ID "realtime"
 
+/* Every thread is a RealtimeKit call, and audio and video apps only
+ * have a handful of threads that need it */
+#define MAX_THREADS 64
+
 typedef struct _Realtime Realtime;
 typedef struct _RealtimeClass RealtimeClass;
 
@@ -58,8 +62,15 @@ G_DEFINE_TYPE_WITH_CODE (Realtime, realtime, XDP_DBUS_TYPE_REALTIME_SKELETON,
                          G_IMPLEMENT_INTERFACE (XDP_DBUS_TYPE_REALTIME,
                                                 realtime_iface_init));
 
+/* Pid and tid lookups go through the translation cache of xdp_map_pids()
+ * and xdp_map_tids(), so threads of an already known process don't need
+ * another /proc scan. */
 static gboolean
-map_pid (XdpAppInfo *app_info, pid_t *pid, pid_t *tid, GError **error)
+map_pid_and_tids (XdpAppInfo *app_info,
+                  pid_t      *pid,
+                  pid_t      *tids,
+                  guint       n_tids,
+                  GError    **error)
 {
   ino_t pidns_id;
 
@@ -77,7 +88,7 @@ map_pid (XdpAppInfo *app_info, pid_t *pid, pid_t *tid, GError **error)
       return FALSE;
     }
 
-  if (pidns_id != 0 && !xdp_map_tids (pidns_id, *pid, tid, 1, error))
+  if (pidns_id != 0 && !xdp_map_tids (pidns_id, *pid, tids, n_tids, error))
     {
       g_prefix_error (error, "Could not map tid: ");
       g_warning ("Realtime error: %s", (*error)->message);
@@ -87,6 +98,12 @@ map_pid (XdpAppInfo *app_info, pid_t *pid, pid_t *tid, GError **error)
   return TRUE;
 }
 
+static gboolean
+map_pid (XdpAppInfo *app_info, pid_t *pid, pid_t *tid, GError **error)
+{
+  return map_pid_and_tids (app_info, pid, tid, 1, error);
+}
+
 static void
 on_call_ready (GObject      *source_object,
                GAsyncResult *result,
@@ -106,6 +123,140 @@ on_call_ready (GObject      *source_object,
     g_dbus_method_invocation_return_value (invocation, g_variant_new ("()"));
 }
 
+typedef struct
+{
+  GDBusMethodInvocation *invocation;
+  gint n_pending;
+  GMutex mutex;
+  GError *error;
+} RealtimeBatch;
+
+static void
+realtime_batch_free (RealtimeBatch *batch)
+{
+  g_clear_object (&batch->invocation);
+  g_clear_error (&batch->error);
+  g_mutex_clear (&batch->mutex);
+  g_free (batch);
+}
+
+static void
+on_batch_call_ready (GObject      *source_object,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+{
+  RealtimeBatch *batch = user_data;
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GVariant) response = NULL;
+
+  response = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object),
+                                       result,
+                                       &error);
+
+  if (error)
+    {
+      g_mutex_lock (&batch->mutex);
+      if (batch->error == NULL)
+        batch->error = g_steal_pointer (&error);
+      g_mutex_unlock (&batch->mutex);
+    }
+
+  if (!g_atomic_int_dec_and_test (&batch->n_pending))
+    return;
+
+  if (batch->error)
+    g_dbus_method_invocation_return_gerror (batch->invocation, batch->error);
+  else
+    g_dbus_method_invocation_return_value (batch->invocation, g_variant_new ("()"));
+
+  realtime_batch_free (batch);
+}
+
+/* RealtimeKit has no batch API, so send all the calls at once and reply
+ * when the last one is done */
+static void
+make_threads_realtime_or_high_priority (GDBusMethodInvocation *invocation,
+                                        const char            *method,
+                                        guint64                process,
+                                        GVariant              *threads,
+                                        GVariant              *priority)
+{
+  g_autoptr (GError) error = NULL;
+  g_autoptr (GVariant) owned_priority = g_variant_ref_sink (priority);
+  XdpCall *call = xdp_call_from_invocation (invocation);
+  const char *app_id = xdp_app_info_get_id (call->app_info);
+  g_autofree pid_t *tids = NULL;
+  pid_t pid = process;
+  RealtimeBatch *batch;
+  XdpPermission permission;
+  const guint64 *threads_data;
+  gsize n_threads;
+  gsize i;
+
+  threads_data = g_variant_get_fixed_array (threads, &n_threads, sizeof (guint64));
+  if (n_threads > MAX_THREADS)
+    {
+      g_dbus_method_invocation_return_error (invocation,
+                                             XDG_DESKTOP_PORTAL_ERROR,
+                                             XDG_DESKTOP_PORTAL_ERROR_INVALID_ARGUMENT,
+                                             "Too many threads, at most %d are supported",
+                                             MAX_THREADS);
+      return;
+    }
+
+  if (!realtime->rtkit_proxy)
+    {
+      g_dbus_method_invocation_return_error (invocation,
+                                             XDG_DESKTOP_PORTAL_ERROR,
+                                             XDG_DESKTOP_PORTAL_ERROR_FAILED,
+                                             "RealtimeKit was not found");
+      return;
+    }
+
+  permission = xdp_get_permission_sync (app_id, PERMISSION_TABLE, PERMISSION_ID);
+  if (permission == XDP_PERMISSION_NO)
+    {
+      g_dbus_method_invocation_return_error (invocation,
+                                             XDG_DESKTOP_PORTAL_ERROR,
+                                             XDG_DESKTOP_PORTAL_ERROR_NOT_ALLOWED,
+                                             "Permission denied");
+      return;
+    }
+
+  if (n_threads == 0)
+    {
+      g_dbus_method_invocation_return_value (invocation, g_variant_new ("()"));
+      return;
+    }
+
+  tids = g_new (pid_t, n_threads);
+  for (i = 0; i < n_threads; i++)
+    tids[i] = threads_data[i];
+
+  if (!map_pid_and_tids (call->app_info, &pid, tids, n_threads, &error))
+    {
+      g_dbus_method_invocation_return_gerror (invocation, error);
+      return;
+    }
+
+  batch = g_new0 (RealtimeBatch, 1);
+  batch->invocation = g_object_ref (invocation);
+  batch->n_pending = n_threads;
+  g_mutex_init (&batch->mutex);
+
+  for (i = 0; i < n_threads; i++)
+    {
+      g_dbus_proxy_call (G_DBUS_PROXY (realtime->rtkit_proxy),
+                         method,
+                         g_variant_new ("(tt@*)", (guint64) pid, (guint64) tids[i], owned_priority),
+                         G_DBUS_CALL_FLAGS_NONE,
+                         -1,
+                         NULL,
+                         on_batch_call_ready,
+                         batch);
+    }
+}
+
 static gboolean
 handle_make_thread_realtime_with_pid (XdpDbusRealtime       *object,
                                       GDBusMethodInvocation *invocation,
@@ -208,17 +359,51 @@ handle_make_thread_high_priority_with_pid (XdpDbusRealtime       *object,
   return G_DBUS_METHOD_INVOCATION_HANDLED;
 }
 
+static gboolean
+handle_make_threads_realtime_with_pid (XdpDbusRealtime       *object,
+                                       GDBusMethodInvocation *invocation,
+                                       guint64                process,
+                                       GVariant              *threads,
+                                       guint32                priority)
+{
+  make_threads_realtime_or_high_priority (invocation,
+                                          "MakeThreadRealtimeWithPID",
+                                          process,
+                                          threads,
+                                          g_variant_new_uint32 (priority));
+
+  return G_DBUS_METHOD_INVOCATION_HANDLED;
+}
+
+static gboolean
+handle_make_threads_high_priority_with_pid (XdpDbusRealtime       *object,
+                                            GDBusMethodInvocation *invocation,
+                                            guint64                process,
+                                            GVariant              *threads,
+                                            gint32                 priority)
+{
+  make_threads_realtime_or_high_priority (invocation,
+                                          "MakeThreadHighPriorityWithPID",
+                                          process,
+                                          threads,
+                                          g_variant_new_int32 (priority));
+
+  return G_DBUS_METHOD_INVOCATION_HANDLED;
+}
+
 static void
 realtime_iface_init (XdpDbusRealtimeIface *iface)
 {
   iface->handle_make_thread_realtime_with_pid = handle_make_thread_realtime_with_pid;
   iface->handle_make_thread_high_priority_with_pid = handle_make_thread_high_priority_with_pid;
+  iface->handle_make_threads_realtime_with_pid = handle_make_threads_realtime_with_pid;
+  iface->handle_make_threads_high_priority_with_pid = handle_make_threads_high_priority_with_pid;
 }
 
 static void
 realtime_init (Realtime *realtime)
 {
-  xdp_dbus_realtime_set_version (XDP_DBUS_REALTIME (realtime), 1);
+  xdp_dbus_realtime_set_version (XDP_DBUS_REALTIME (realtime), 2);
 }
 
 static void
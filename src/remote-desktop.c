@@ -77,6 +77,12 @@ typedef enum _DeviceType
   DEVICE_TYPE_TOUCHSCREEN = 1 << 2,
 } DeviceType;
 
+typedef struct
+{
+  int32_t width;
+  int32_t height;
+} StreamSize;
+
 typedef struct _RemoteDesktopSession
 {
   XdpSession parent;
@@ -86,6 +92,14 @@ typedef struct _RemoteDesktopSession
   DeviceType shared_devices;
 
   GList *streams;
+  StreamSize *stream_sizes;
+  size_t n_stream_sizes;
+
+  /* Relative pointer motion is merged while the backend is busy */
+  guint n_motions_in_flight;
+  gboolean has_pending_motion;
+  double pending_dx;
+  double pending_dy;
 
   gboolean clipboard_requested;
 
@@ -293,7 +307,7 @@ handle_create_session (XdpDbusRemoteDesktop *object,
 {
   XdpRequest *request = xdp_request_from_invocation (invocation);
   g_autoptr(GError) error = NULL;
-  g_autoptr(XdpDbusImplRequest) impl_request = NULL;
+  g_autoptr(XdpImplRequest) impl_request = NULL;
   XdpSession *session;
   g_auto(GVariantBuilder) options_builder =
     G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
@@ -301,17 +315,7 @@ handle_create_session (XdpDbusRemoteDesktop *object,
 
   REQUEST_AUTOLOCK (request);
 
-  impl_request =
-    xdp_dbus_impl_request_proxy_new_sync (g_dbus_proxy_get_connection (G_DBUS_PROXY (impl)),
-                                          G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
-                                          g_dbus_proxy_get_name (G_DBUS_PROXY (impl)),
-                                          request->id,
-                                          NULL, &error);
-  if (!impl_request)
-    {
-      g_dbus_method_invocation_return_gerror (invocation, error);
-      return G_DBUS_METHOD_INVOCATION_HANDLED;
-    }
+  impl_request = xdp_impl_request_new (G_DBUS_PROXY (impl), request->id);
 
   xdp_request_set_impl_request (request, impl_request);
   xdp_request_export (request, g_dbus_method_invocation_get_connection (invocation));
@@ -500,7 +504,7 @@ handle_select_devices (XdpDbusRemoteDesktop *object,
   XdpSession *session;
   RemoteDesktopSession *remote_desktop_session;
   g_autoptr(GError) error = NULL;
-  g_autoptr(XdpDbusImplRequest) impl_request = NULL;
+  g_autoptr(XdpImplRequest) impl_request = NULL;
   g_auto(GVariantBuilder) options_builder =
     G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
   g_autoptr(GVariant) options = NULL;
@@ -530,17 +534,7 @@ handle_select_devices (XdpDbusRemoteDesktop *object,
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
-  impl_request =
-    xdp_dbus_impl_request_proxy_new_sync (g_dbus_proxy_get_connection (G_DBUS_PROXY (impl)),
-                                          G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
-                                          g_dbus_proxy_get_name (G_DBUS_PROXY (impl)),
-                                          request->id,
-                                          NULL, &error);
-  if (!impl_request)
-    {
-      g_dbus_method_invocation_return_gerror (invocation, error);
-      return G_DBUS_METHOD_INVOCATION_HANDLED;
-    }
+  impl_request = xdp_impl_request_new (G_DBUS_PROXY (impl), request->id);
 
   xdp_request_set_impl_request (request, impl_request);
   xdp_request_export (request, g_dbus_method_invocation_get_connection (invocation));
@@ -609,8 +603,24 @@ process_results (RemoteDesktopSession *remote_desktop_session,
 
   if (g_variant_lookup (results, "streams", "a(ua{sv})", &streams_iter))
     {
+      size_t i = 0;
+
       remote_desktop_session->streams =
         collect_screen_cast_stream_data (streams_iter);
+
+      /* Positions are checked against every stream on every event */
+      g_clear_pointer (&remote_desktop_session->stream_sizes, g_free);
+      remote_desktop_session->n_stream_sizes =
+        g_list_length (remote_desktop_session->streams);
+      remote_desktop_session->stream_sizes =
+        g_new0 (StreamSize, remote_desktop_session->n_stream_sizes);
+
+      for (GList *l = remote_desktop_session->streams; l; l = l->next, i++)
+        {
+          StreamSize *size = &remote_desktop_session->stream_sizes[i];
+
+          screen_cast_stream_get_size (l->data, &size->width, &size->height);
+        }
     }
 
   if (g_variant_lookup (results, "devices", "u", &devices))
@@ -707,8 +717,7 @@ handle_start (XdpDbusRemoteDesktop *object,
   XdpRequest *request = xdp_request_from_invocation (invocation);
   XdpSession *session;
   RemoteDesktopSession *remote_desktop_session;
-  g_autoptr(GError) error = NULL;
-  g_autoptr(XdpDbusImplRequest) impl_request = NULL;
+  g_autoptr(XdpImplRequest) impl_request = NULL;
   g_auto(GVariantBuilder) options_builder =
     G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
   g_autoptr(GVariant) options = NULL;
@@ -749,17 +758,7 @@ handle_start (XdpDbusRemoteDesktop *object,
   g_object_set_data_full (G_OBJECT (request),
                           "window", g_strdup (arg_parent_window), g_free);
 
-  impl_request =
-    xdp_dbus_impl_request_proxy_new_sync (g_dbus_proxy_get_connection (G_DBUS_PROXY (impl)),
-                                          G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
-                                          g_dbus_proxy_get_name (G_DBUS_PROXY (impl)),
-                                          request->id,
-                                          NULL, &error);
-  if (!impl_request)
-    {
-      g_dbus_method_invocation_return_gerror (invocation, error);
-      return G_DBUS_METHOD_INVOCATION_HANDLED;
-    }
+  impl_request = xdp_impl_request_new (G_DBUS_PROXY (impl), request->id);
 
   xdp_request_set_impl_request (request, impl_request);
   xdp_request_export (request, g_dbus_method_invocation_get_connection (invocation));
@@ -817,23 +816,148 @@ check_position (XdpSession *session,
                 double y)
 {
   RemoteDesktopSession *remote_desktop_session = REMOTE_DESKTOP_SESSION (session);
-  GList *l;
 
-  for (l = remote_desktop_session->streams; l; l = l->next)
+  for (size_t i = 0; i < remote_desktop_session->n_stream_sizes; i++)
     {
-      ScreenCastStream *stream = l->data;
-      int32_t width, height;
-
-      screen_cast_stream_get_size (stream, &width, &height);
+      const StreamSize *size = &remote_desktop_session->stream_sizes[i];
 
-      if (x >= 0.0 && x < width &&
-          y >= 0.0 && y < height)
+      if (x >= 0.0 && x < size->width &&
+          y >= 0.0 && y < size->height)
         return TRUE;
     }
 
   return FALSE;
 }
 
+static GVariant *
+get_empty_options (void)
+{
+  static GVariant *empty_options = NULL;
+
+  if (g_once_init_enter (&empty_options))
+    {
+      GVariant *options;
+
+      options = g_variant_new_array (G_VARIANT_TYPE ("{sv}"), NULL, 0);
+      g_once_init_leave (&empty_options, g_variant_ref_sink (options));
+    }
+
+  return empty_options;
+}
+
+/* Clients rarely pass any options to the Notify methods, and filtering
+ * them would only build another empty vardict for every event */
+static gboolean
+filter_notify_options (GVariant            *arg_options,
+                       const XdpOptionKey  *option_keys,
+                       int                  n_option_keys,
+                       GVariant           **out_options,
+                       GError             **error)
+{
+  g_auto(GVariantBuilder) options_builder =
+    G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
+
+  if (g_variant_n_children (arg_options) == 0)
+    {
+      *out_options = g_variant_ref (get_empty_options ());
+      return TRUE;
+    }
+
+  if (!xdp_filter_options (arg_options, &options_builder,
+                           option_keys, n_option_keys,
+                           error))
+    return FALSE;
+
+  *out_options = g_variant_ref_sink (g_variant_builder_end (&options_builder));
+  return TRUE;
+}
+
+static void send_pointer_motion (XdpSession *session,
+                                 double      dx,
+                                 double      dy);
+
+/* Sends the motion that was merged while waiting for the backend. This
+ * must happen before any other event is forwarded, to keep them in order.
+ */
+static void
+flush_pointer_motion (XdpSession *session)
+{
+  RemoteDesktopSession *remote_desktop_session = REMOTE_DESKTOP_SESSION (session);
+
+  if (!remote_desktop_session->has_pending_motion)
+    return;
+
+  send_pointer_motion (session,
+                       remote_desktop_session->pending_dx,
+                       remote_desktop_session->pending_dy);
+
+  remote_desktop_session->has_pending_motion = FALSE;
+  remote_desktop_session->pending_dx = 0.0;
+  remote_desktop_session->pending_dy = 0.0;
+}
+
+static void
+pointer_motion_done (GObject      *source_object,
+                     GAsyncResult *result,
+                     gpointer      data)
+{
+  g_autoptr(XdpSession) session = data;
+  RemoteDesktopSession *remote_desktop_session = REMOTE_DESKTOP_SESSION (session);
+  g_autoptr(GError) error = NULL;
+
+  if (!xdp_dbus_impl_remote_desktop_call_notify_pointer_motion_finish (impl, result, &error))
+    g_debug ("Backend failed to handle pointer motion: %s", error->message);
+
+  SESSION_AUTOLOCK (session);
+
+  remote_desktop_session->n_motions_in_flight--;
+
+  if (remote_desktop_session->state == REMOTE_DESKTOP_SESSION_STATE_CLOSED)
+    remote_desktop_session->has_pending_motion = FALSE;
+  else if (remote_desktop_session->n_motions_in_flight == 0)
+    flush_pointer_motion (session);
+}
+
+static void
+send_pointer_motion (XdpSession *session,
+                     double      dx,
+                     double      dy)
+{
+  RemoteDesktopSession *remote_desktop_session = REMOTE_DESKTOP_SESSION (session);
+
+  remote_desktop_session->n_motions_in_flight++;
+
+  /* Relative motion has no options, so nothing is lost when merging */
+  xdp_dbus_impl_remote_desktop_call_notify_pointer_motion (impl,
+                                                           session->id,
+                                                           get_empty_options (),
+                                                           dx, dy,
+                                                           NULL,
+                                                           pointer_motion_done,
+                                                           g_object_ref (session));
+}
+
+/* Motion that arrives while the backend is still handling the previous
+ * one is added up, and sent once the backend is done with it. This bounds
+ * the latency of the following events, however fast the client is. */
+static void
+notify_pointer_motion (XdpSession *session,
+                       double      dx,
+                       double      dy)
+{
+  RemoteDesktopSession *remote_desktop_session = REMOTE_DESKTOP_SESSION (session);
+
+  if (remote_desktop_session->n_motions_in_flight > 0)
+    {
+      remote_desktop_session->pending_dx += dx;
+      remote_desktop_session->pending_dy += dy;
+      remote_desktop_session->has_pending_motion = TRUE;
+      return;
+    }
+
+  send_pointer_motion (session, dx, dy);
+}
+
 static XdpOptionKey remote_desktop_notify_options[] = {
 };
 
@@ -847,8 +971,6 @@ handle_notify_pointer_motion (XdpDbusRemoteDesktop *object,
 {
   XdpCall *call = xdp_call_from_invocation (invocation);
   XdpSession *session;
-  g_auto(GVariantBuilder) options_builder =
-    G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
   g_autoptr(GVariant) options = NULL;
   g_autoptr(GError) error = NULL;
 
@@ -873,21 +995,17 @@ handle_notify_pointer_motion (XdpDbusRemoteDesktop *object,
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
-  if (!xdp_filter_options (arg_options, &options_builder,
-                           remote_desktop_notify_options,
-                           G_N_ELEMENTS (remote_desktop_notify_options),
-                           &error))
+  if (!filter_notify_options (arg_options,
+                              remote_desktop_notify_options,
+                              G_N_ELEMENTS (remote_desktop_notify_options),
+                              &options,
+                              &error))
     {
       g_dbus_method_invocation_return_gerror (invocation, error);
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
-  options = g_variant_ref_sink (g_variant_builder_end (&options_builder));
 
-  xdp_dbus_impl_remote_desktop_call_notify_pointer_motion (impl,
-                                                           session->id,
-                                                           options,
-                                                           dx, dy,
-                                                           NULL, NULL, NULL);
+  notify_pointer_motion (session, dx, dy);
 
   xdp_dbus_remote_desktop_complete_notify_pointer_motion (object, invocation);
 
@@ -905,8 +1023,6 @@ handle_notify_pointer_motion_absolute (XdpDbusRemoteDesktop *object,
 {
   XdpCall *call = xdp_call_from_invocation (invocation);
   XdpSession *session;
-  g_auto(GVariantBuilder) options_builder =
-    G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
   g_autoptr(GVariant) options = NULL;
   g_autoptr(GError) error = NULL;
 
@@ -940,16 +1056,17 @@ handle_notify_pointer_motion_absolute (XdpDbusRemoteDesktop *object,
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
-  if (!xdp_filter_options (arg_options, &options_builder,
-                           remote_desktop_notify_options,
-                           G_N_ELEMENTS (remote_desktop_notify_options),
-                           &error))
+  if (!filter_notify_options (arg_options,
+                              remote_desktop_notify_options,
+                              G_N_ELEMENTS (remote_desktop_notify_options),
+                              &options,
+                              &error))
     {
       g_dbus_method_invocation_return_gerror (invocation, error);
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
-  options = g_variant_ref_sink (g_variant_builder_end (&options_builder));
+  flush_pointer_motion (session);
 
   xdp_dbus_impl_remote_desktop_call_notify_pointer_motion_absolute (impl,
                                                                     session->id,
@@ -973,8 +1090,6 @@ handle_notify_pointer_button (XdpDbusRemoteDesktop *object,
 {
   XdpCall *call = xdp_call_from_invocation (invocation);
   XdpSession *session;
-  g_auto(GVariantBuilder) options_builder =
-    G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
   g_autoptr(GVariant) options = NULL;
   g_autoptr(GError) error = NULL;
 
@@ -999,16 +1114,17 @@ handle_notify_pointer_button (XdpDbusRemoteDesktop *object,
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
-  if (!xdp_filter_options (arg_options, &options_builder,
-                           remote_desktop_notify_options,
-                           G_N_ELEMENTS (remote_desktop_notify_options),
-                           &error))
+  if (!filter_notify_options (arg_options,
+                              remote_desktop_notify_options,
+                              G_N_ELEMENTS (remote_desktop_notify_options),
+                              &options,
+                              &error))
     {
       g_dbus_method_invocation_return_gerror (invocation, error);
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
-  options = g_variant_ref_sink (g_variant_builder_end (&options_builder));
+  flush_pointer_motion (session);
 
   xdp_dbus_impl_remote_desktop_call_notify_pointer_button (impl,
                                                            session->id,
@@ -1036,8 +1152,6 @@ handle_notify_pointer_axis (XdpDbusRemoteDesktop *object,
 {
   XdpCall *call = xdp_call_from_invocation (invocation);
   XdpSession *session;
-  g_auto(GVariantBuilder) options_builder =
-    G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
   g_autoptr(GVariant) options = NULL;
   g_autoptr(GError) error = NULL;
 
@@ -1062,16 +1176,17 @@ handle_notify_pointer_axis (XdpDbusRemoteDesktop *object,
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
-  if (!xdp_filter_options (arg_options, &options_builder,
-                           remote_desktop_notify_pointer_axis_options,
-                           G_N_ELEMENTS (remote_desktop_notify_pointer_axis_options),
-                           &error))
+  if (!filter_notify_options (arg_options,
+                              remote_desktop_notify_pointer_axis_options,
+                              G_N_ELEMENTS (remote_desktop_notify_pointer_axis_options),
+                              &options,
+                              &error))
     {
       g_dbus_method_invocation_return_gerror (invocation, error);
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
-  options = g_variant_ref_sink (g_variant_builder_end (&options_builder));
+  flush_pointer_motion (session);
 
   xdp_dbus_impl_remote_desktop_call_notify_pointer_axis (impl,
                                                          session->id,
@@ -1094,8 +1209,6 @@ handle_notify_pointer_axis_discrete (XdpDbusRemoteDesktop *object,
 {
   XdpCall *call = xdp_call_from_invocation (invocation);
   XdpSession *session;
-  g_auto(GVariantBuilder) options_builder =
-    G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
   g_autoptr(GVariant) options = NULL;
   g_autoptr(GError) error = NULL;
 
@@ -1120,15 +1233,17 @@ handle_notify_pointer_axis_discrete (XdpDbusRemoteDesktop *object,
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
-  if (!xdp_filter_options (arg_options, &options_builder,
-                           remote_desktop_notify_options,
-                           G_N_ELEMENTS (remote_desktop_notify_options),
-                           &error))
+  if (!filter_notify_options (arg_options,
+                              remote_desktop_notify_options,
+                              G_N_ELEMENTS (remote_desktop_notify_options),
+                              &options,
+                              &error))
     {
       g_dbus_method_invocation_return_gerror (invocation, error);
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
-  options = g_variant_ref_sink (g_variant_builder_end (&options_builder));
+
+  flush_pointer_motion (session);
 
   xdp_dbus_impl_remote_desktop_call_notify_pointer_axis_discrete (impl,
                                                                   session->id,
@@ -1152,8 +1267,6 @@ handle_notify_keyboard_keycode (XdpDbusRemoteDesktop *object,
 {
   XdpCall *call = xdp_call_from_invocation (invocation);
   XdpSession *session;
-  g_auto(GVariantBuilder) options_builder =
-    G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
   g_autoptr(GVariant) options = NULL;
   g_autoptr(GError) error = NULL;
 
@@ -1178,15 +1291,17 @@ handle_notify_keyboard_keycode (XdpDbusRemoteDesktop *object,
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
-  if (!xdp_filter_options (arg_options, &options_builder,
-                           remote_desktop_notify_options,
-                           G_N_ELEMENTS (remote_desktop_notify_options),
-                           &error))
+  if (!filter_notify_options (arg_options,
+                              remote_desktop_notify_options,
+                              G_N_ELEMENTS (remote_desktop_notify_options),
+                              &options,
+                              &error))
     {
       g_dbus_method_invocation_return_gerror (invocation, error);
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
-  options = g_variant_ref_sink (g_variant_builder_end (&options_builder));
+
+  flush_pointer_motion (session);
 
   xdp_dbus_impl_remote_desktop_call_notify_keyboard_keycode (impl,
                                                              session->id,
@@ -1210,8 +1325,6 @@ handle_notify_keyboard_keysym (XdpDbusRemoteDesktop *object,
 {
   XdpCall *call = xdp_call_from_invocation (invocation);
   XdpSession *session;
-  g_auto(GVariantBuilder) options_builder =
-    G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
   g_autoptr(GVariant) options = NULL;
   g_autoptr(GError) error = NULL;
 
@@ -1236,15 +1349,17 @@ handle_notify_keyboard_keysym (XdpDbusRemoteDesktop *object,
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
-  if (!xdp_filter_options (arg_options, &options_builder,
-                           remote_desktop_notify_options,
-                           G_N_ELEMENTS (remote_desktop_notify_options),
-                           &error))
+  if (!filter_notify_options (arg_options,
+                              remote_desktop_notify_options,
+                              G_N_ELEMENTS (remote_desktop_notify_options),
+                              &options,
+                              &error))
     {
       g_dbus_method_invocation_return_gerror (invocation, error);
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
-  options = g_variant_ref_sink (g_variant_builder_end (&options_builder));
+
+  flush_pointer_motion (session);
 
   xdp_dbus_impl_remote_desktop_call_notify_keyboard_keysym (impl,
                                                             session->id,
@@ -1270,8 +1385,6 @@ handle_notify_touch_down (XdpDbusRemoteDesktop *object,
 {
   XdpCall *call = xdp_call_from_invocation (invocation);
   XdpSession *session;
-  g_auto(GVariantBuilder) options_builder =
-    G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
   g_autoptr(GVariant) options = NULL;
   g_autoptr(GError) error = NULL;
 
@@ -1305,15 +1418,17 @@ handle_notify_touch_down (XdpDbusRemoteDesktop *object,
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
-  if (!xdp_filter_options (arg_options, &options_builder,
-                           remote_desktop_notify_options,
-                           G_N_ELEMENTS (remote_desktop_notify_options),
-                           &error))
+  if (!filter_notify_options (arg_options,
+                              remote_desktop_notify_options,
+                              G_N_ELEMENTS (remote_desktop_notify_options),
+                              &options,
+                              &error))
     {
       g_dbus_method_invocation_return_gerror (invocation, error);
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
-  options = g_variant_ref_sink (g_variant_builder_end (&options_builder));
+
+  flush_pointer_motion (session);
 
   xdp_dbus_impl_remote_desktop_call_notify_touch_down (impl,
                                                        session->id,
@@ -1340,8 +1455,6 @@ handle_notify_touch_motion (XdpDbusRemoteDesktop *object,
 {
   XdpCall *call = xdp_call_from_invocation (invocation);
   XdpSession *session;
-  g_auto(GVariantBuilder) options_builder =
-    G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
   g_autoptr(GVariant) options = NULL;
   g_autoptr(GError) error = NULL;
 
@@ -1375,15 +1488,17 @@ handle_notify_touch_motion (XdpDbusRemoteDesktop *object,
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
-  if (!xdp_filter_options (arg_options, &options_builder,
-                           remote_desktop_notify_options,
-                           G_N_ELEMENTS (remote_desktop_notify_options),
-                           &error))
+  if (!filter_notify_options (arg_options,
+                              remote_desktop_notify_options,
+                              G_N_ELEMENTS (remote_desktop_notify_options),
+                              &options,
+                              &error))
     {
       g_dbus_method_invocation_return_gerror (invocation, error);
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
-  options = g_variant_ref_sink (g_variant_builder_end (&options_builder));
+
+  flush_pointer_motion (session);
 
   xdp_dbus_impl_remote_desktop_call_notify_touch_motion (impl,
                                                          session->id,
@@ -1407,8 +1522,6 @@ handle_notify_touch_up (XdpDbusRemoteDesktop *object,
 {
   XdpCall *call = xdp_call_from_invocation (invocation);
   XdpSession *session;
-  g_auto(GVariantBuilder) options_builder =
-    G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
   g_autoptr(GVariant) options = NULL;
   g_autoptr(GError) error = NULL;
 
@@ -1433,15 +1546,17 @@ handle_notify_touch_up (XdpDbusRemoteDesktop *object,
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
-  if (!xdp_filter_options (arg_options, &options_builder,
-                           remote_desktop_notify_options,
-                           G_N_ELEMENTS (remote_desktop_notify_options),
-                           &error))
+  if (!filter_notify_options (arg_options,
+                              remote_desktop_notify_options,
+                              G_N_ELEMENTS (remote_desktop_notify_options),
+                              &options,
+                              &error))
     {
       g_dbus_method_invocation_return_gerror (invocation, error);
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
-  options = g_variant_ref_sink (g_variant_builder_end (&options_builder));
+
+  flush_pointer_motion (session);
 
   xdp_dbus_impl_remote_desktop_call_notify_touch_up (impl,
                                                      session->id,
@@ -1454,6 +1569,339 @@ handle_notify_touch_up (XdpDbusRemoteDesktop *object,
   return G_DBUS_METHOD_INVOCATION_HANDLED;
 }
 
+typedef enum
+{
+  NOTIFY_EVENT_POINTER_MOTION,
+  NOTIFY_EVENT_POINTER_MOTION_ABSOLUTE,
+  NOTIFY_EVENT_POINTER_BUTTON,
+  NOTIFY_EVENT_POINTER_AXIS,
+  NOTIFY_EVENT_POINTER_AXIS_DISCRETE,
+  NOTIFY_EVENT_KEYBOARD_KEYCODE,
+  NOTIFY_EVENT_KEYBOARD_KEYSYM,
+  NOTIFY_EVENT_TOUCH_DOWN,
+  NOTIFY_EVENT_TOUCH_MOTION,
+  NOTIFY_EVENT_TOUCH_UP,
+} NotifyEventType;
+
+static const struct {
+  const char *name;
+  const char *signature;
+  DeviceType device_type;
+} notify_event_types[] = {
+  [NOTIFY_EVENT_POINTER_MOTION] = { "pointer-motion", "(dd)", DEVICE_TYPE_POINTER },
+  [NOTIFY_EVENT_POINTER_MOTION_ABSOLUTE] = { "pointer-motion-absolute", "(udd)", DEVICE_TYPE_POINTER },
+  [NOTIFY_EVENT_POINTER_BUTTON] = { "pointer-button", "(iu)", DEVICE_TYPE_POINTER },
+  [NOTIFY_EVENT_POINTER_AXIS] = { "pointer-axis", "(ddb)", DEVICE_TYPE_POINTER },
+  [NOTIFY_EVENT_POINTER_AXIS_DISCRETE] = { "pointer-axis-discrete", "(ui)", DEVICE_TYPE_POINTER },
+  [NOTIFY_EVENT_KEYBOARD_KEYCODE] = { "keyboard-keycode", "(iu)", DEVICE_TYPE_KEYBOARD },
+  [NOTIFY_EVENT_KEYBOARD_KEYSYM] = { "keyboard-keysym", "(iu)", DEVICE_TYPE_KEYBOARD },
+  [NOTIFY_EVENT_TOUCH_DOWN] = { "touch-down", "(uudd)", DEVICE_TYPE_TOUCHSCREEN },
+  [NOTIFY_EVENT_TOUCH_MOTION] = { "touch-motion", "(uudd)", DEVICE_TYPE_TOUCHSCREEN },
+  [NOTIFY_EVENT_TOUCH_UP] = { "touch-up", "(u)", DEVICE_TYPE_TOUCHSCREEN },
+};
+
+static gboolean
+lookup_notify_event_type (const char      *name,
+                          NotifyEventType *out_type)
+{
+  for (size_t i = 0; i < G_N_ELEMENTS (notify_event_types); i++)
+    {
+      if (g_str_equal (name, notify_event_types[i].name))
+        {
+          *out_type = i;
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+/* Checks all events before any of them is forwarded, so that a batch is
+ * either notified about as a whole, or not at all */
+static gboolean
+validate_notify_events (XdpSession  *session,
+                        GVariant    *events,
+                        GError     **error)
+{
+  DeviceType allowed_devices = DEVICE_TYPE_NONE;
+  DeviceType denied_devices = DEVICE_TYPE_NONE;
+  GVariantIter iter;
+  const char *name;
+  GVariant *args;
+
+  g_variant_iter_init (&iter, events);
+  for (size_t i = 0; g_variant_iter_next (&iter, "(&sv)", &name, &args); i++)
+    {
+      g_autoptr(GVariant) event_args = args;
+      NotifyEventType type;
+      DeviceType device_type;
+      uint32_t stream, slot;
+      double x, y;
+
+      if (!lookup_notify_event_type (name, &type))
+        {
+          g_set_error (error, XDG_DESKTOP_PORTAL_ERROR,
+                       XDG_DESKTOP_PORTAL_ERROR_INVALID_ARGUMENT,
+                       "Unknown event type '%s' at index %" G_GSIZE_FORMAT,
+                       name, i);
+          return FALSE;
+        }
+
+      if (!g_variant_is_of_type (event_args,
+                                 G_VARIANT_TYPE (notify_event_types[type].signature)))
+        {
+          g_set_error (error, XDG_DESKTOP_PORTAL_ERROR,
+                       XDG_DESKTOP_PORTAL_ERROR_INVALID_ARGUMENT,
+                       "Expected type '%s' for %s event at index %" G_GSIZE_FORMAT,
+                       notify_event_types[type].signature, name, i);
+          return FALSE;
+        }
+
+      /* The session only needs checking once per device type */
+      device_type = notify_event_types[type].device_type;
+      if ((allowed_devices & device_type) == 0)
+        {
+          if ((denied_devices & device_type) == 0 &&
+              check_notify (session, device_type))
+            allowed_devices |= device_type;
+          else
+            denied_devices |= device_type;
+        }
+
+      if (denied_devices & device_type)
+        {
+          g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+                       "Session is not allowed to notify about %s events", name);
+          return FALSE;
+        }
+
+      switch (type)
+        {
+        case NOTIFY_EVENT_POINTER_MOTION_ABSOLUTE:
+          g_variant_get (event_args, "(udd)", &stream, &x, &y);
+          break;
+
+        case NOTIFY_EVENT_TOUCH_DOWN:
+        case NOTIFY_EVENT_TOUCH_MOTION:
+          g_variant_get (event_args, "(uudd)", &stream, &slot, &x, &y);
+          break;
+
+        default:
+          continue;
+        }
+
+      if (!check_position (session, stream, x, y))
+        {
+          g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+                       "Invalid position for %s event at index %" G_GSIZE_FORMAT,
+                       name, i);
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static void
+forward_notify_event (XdpSession      *session,
+                      NotifyEventType  type,
+                      GVariant        *args,
+                      GVariant        *options)
+{
+  uint32_t stream, slot, axis, state;
+  int32_t steps, code;
+  double x, y;
+  gboolean finish;
+
+  switch (type)
+    {
+    case NOTIFY_EVENT_POINTER_MOTION:
+      g_variant_get (args, "(dd)", &x, &y);
+      notify_pointer_motion (session, x, y);
+      break;
+
+    case NOTIFY_EVENT_POINTER_MOTION_ABSOLUTE:
+      g_variant_get (args, "(udd)", &stream, &x, &y);
+      xdp_dbus_impl_remote_desktop_call_notify_pointer_motion_absolute (impl, session->id, options,
+                                                                        stream, x, y,
+                                                                        NULL, NULL, NULL);
+      break;
+
+    case NOTIFY_EVENT_POINTER_BUTTON:
+      g_variant_get (args, "(iu)", &code, &state);
+      xdp_dbus_impl_remote_desktop_call_notify_pointer_button (impl, session->id, options,
+                                                               code, state,
+                                                               NULL, NULL, NULL);
+      break;
+
+    case NOTIFY_EVENT_POINTER_AXIS:
+      g_variant_get (args, "(ddb)", &x, &y, &finish);
+      if (finish)
+        {
+          GVariantBuilder axis_options_builder;
+
+          g_variant_builder_init (&axis_options_builder, G_VARIANT_TYPE_VARDICT);
+          g_variant_builder_add (&axis_options_builder, "{sv}",
+                                 "finish", g_variant_new_boolean (TRUE));
+          options = g_variant_builder_end (&axis_options_builder);
+        }
+      xdp_dbus_impl_remote_desktop_call_notify_pointer_axis (impl, session->id, options,
+                                                             x, y,
+                                                             NULL, NULL, NULL);
+      break;
+
+    case NOTIFY_EVENT_POINTER_AXIS_DISCRETE:
+      g_variant_get (args, "(ui)", &axis, &steps);
+      xdp_dbus_impl_remote_desktop_call_notify_pointer_axis_discrete (impl, session->id, options,
+                                                                      axis, steps,
+                                                                      NULL, NULL, NULL);
+      break;
+
+    case NOTIFY_EVENT_KEYBOARD_KEYCODE:
+      g_variant_get (args, "(iu)", &code, &state);
+      xdp_dbus_impl_remote_desktop_call_notify_keyboard_keycode (impl, session->id, options,
+                                                                 code, state,
+                                                                 NULL, NULL, NULL);
+      break;
+
+    case NOTIFY_EVENT_KEYBOARD_KEYSYM:
+      g_variant_get (args, "(iu)", &code, &state);
+      xdp_dbus_impl_remote_desktop_call_notify_keyboard_keysym (impl, session->id, options,
+                                                                code, state,
+                                                                NULL, NULL, NULL);
+      break;
+
+    case NOTIFY_EVENT_TOUCH_DOWN:
+      g_variant_get (args, "(uudd)", &stream, &slot, &x, &y);
+      xdp_dbus_impl_remote_desktop_call_notify_touch_down (impl, session->id, options,
+                                                           stream, slot, x, y,
+                                                           NULL, NULL, NULL);
+      break;
+
+    case NOTIFY_EVENT_TOUCH_MOTION:
+      g_variant_get (args, "(uudd)", &stream, &slot, &x, &y);
+      xdp_dbus_impl_remote_desktop_call_notify_touch_motion (impl, session->id, options,
+                                                             stream, slot, x, y,
+                                                             NULL, NULL, NULL);
+      break;
+
+    case NOTIFY_EVENT_TOUCH_UP:
+      g_variant_get (args, "(u)", &slot);
+      xdp_dbus_impl_remote_desktop_call_notify_touch_up (impl, session->id, options,
+                                                         slot,
+                                                         NULL, NULL, NULL);
+      break;
+    }
+}
+
+/* Backends older than version 3 get one call per event, except for
+ * consecutive relative pointer motions, which are merged */
+static void
+forward_notify_events (XdpSession *session,
+                       GVariant   *events,
+                       GVariant   *options)
+{
+  gboolean has_motion = FALSE;
+  double motion_dx = 0.0;
+  double motion_dy = 0.0;
+  GVariantIter iter;
+  const char *name;
+  GVariant *args;
+
+  g_variant_iter_init (&iter, events);
+  while (g_variant_iter_next (&iter, "(&sv)", &name, &args))
+    {
+      g_autoptr(GVariant) event_args = args;
+      NotifyEventType type;
+
+      if (!lookup_notify_event_type (name, &type))
+        g_assert_not_reached ();
+
+      if (type == NOTIFY_EVENT_POINTER_MOTION)
+        {
+          double dx, dy;
+
+          g_variant_get (event_args, "(dd)", &dx, &dy);
+          motion_dx += dx;
+          motion_dy += dy;
+          has_motion = TRUE;
+          continue;
+        }
+
+      if (has_motion)
+        {
+          notify_pointer_motion (session, motion_dx, motion_dy);
+          motion_dx = motion_dy = 0.0;
+          has_motion = FALSE;
+        }
+
+      flush_pointer_motion (session);
+      forward_notify_event (session, type, event_args, options);
+    }
+
+  if (has_motion)
+    notify_pointer_motion (session, motion_dx, motion_dy);
+}
+
+static gboolean
+handle_notify_events (XdpDbusRemoteDesktop *object,
+                      GDBusMethodInvocation *invocation,
+                      const char *arg_session_handle,
+                      GVariant *arg_options,
+                      GVariant *arg_events)
+{
+  XdpCall *call = xdp_call_from_invocation (invocation);
+  XdpSession *session;
+  g_autoptr(GVariant) options = NULL;
+  g_autoptr(GError) error = NULL;
+
+  session = xdp_session_from_call (arg_session_handle, call);
+  if (!session)
+    {
+      g_dbus_method_invocation_return_error (invocation,
+                                             G_DBUS_ERROR,
+                                             G_DBUS_ERROR_ACCESS_DENIED,
+                                             "Invalid session");
+      return G_DBUS_METHOD_INVOCATION_HANDLED;
+    }
+
+  SESSION_AUTOLOCK_UNREF (session);
+
+  if (!validate_notify_events (session, arg_events, &error))
+    {
+      g_dbus_method_invocation_return_gerror (invocation, error);
+      return G_DBUS_METHOD_INVOCATION_HANDLED;
+    }
+
+  if (!filter_notify_options (arg_options,
+                              remote_desktop_notify_options,
+                              G_N_ELEMENTS (remote_desktop_notify_options),
+                              &options,
+                              &error))
+    {
+      g_dbus_method_invocation_return_gerror (invocation, error);
+      return G_DBUS_METHOD_INVOCATION_HANDLED;
+    }
+
+  if (xdp_dbus_impl_remote_desktop_get_version (impl) >= 3)
+    {
+      flush_pointer_motion (session);
+      xdp_dbus_impl_remote_desktop_call_notify_events (impl,
+                                                       session->id,
+                                                       options,
+                                                       arg_events,
+                                                       NULL, NULL, NULL);
+    }
+  else
+    {
+      forward_notify_events (session, arg_events, options);
+    }
+
+  xdp_dbus_remote_desktop_complete_notify_events (object, invocation);
+
+  return G_DBUS_METHOD_INVOCATION_HANDLED;
+}
+
 static XdpOptionKey remote_desktop_connect_to_eis_options[] = {
 };
 
@@ -1570,6 +2018,7 @@ remote_desktop_iface_init (XdpDbusRemoteDesktopIface *iface)
   iface->handle_notify_touch_down = handle_notify_touch_down;
   iface->handle_notify_touch_motion = handle_notify_touch_motion;
   iface->handle_notify_touch_up = handle_notify_touch_up;
+  iface->handle_notify_events = handle_notify_events;
 
   iface->handle_connect_to_eis = handle_connect_to_eis;
 }
@@ -1596,7 +2045,7 @@ on_supported_device_types_changed (GObject *gobject,
 static void
 remote_desktop_init (RemoteDesktop *remote_desktop)
 {
-  xdp_dbus_remote_desktop_set_version (XDP_DBUS_REMOTE_DESKTOP (remote_desktop), 2);
+  xdp_dbus_remote_desktop_set_version (XDP_DBUS_REMOTE_DESKTOP (remote_desktop), 3);
 
   g_signal_connect (impl, "notify::supported-device-types",
                     G_CALLBACK (on_supported_device_types_changed),
@@ -1651,6 +2100,7 @@ remote_desktop_session_finalize (GObject *object)
 
   g_list_free_full (remote_desktop_session->streams,
                     (GDestroyNotify)screen_cast_stream_free);
+  g_clear_pointer (&remote_desktop_session->stream_sizes, g_free);
 
   G_OBJECT_CLASS (remote_desktop_session_parent_class)->finalize (object);
 }
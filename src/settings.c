@@ -46,9 +46,28 @@ struct _SettingsClass
   XdpDbusSettingsSkeletonClass parent_class;
 };
 
+/* Settings of one backend, as returned by ReadAll() and kept current with
+ * SettingChanged. They are used to answer reads without a round trip to
+ * the backend; when a backend can't be cached, it is queried directly.
+ */
+typedef struct
+{
+  GHashTable *namespaces; /* namespace -> (key -> value) */
+  GHashTable *pending; /* changes received while loading */
+  gboolean loading;
+  gboolean failed;
+  guint generation;
+} SettingsCache;
+
+/* How long a backend gets to answer ReadAll() before it is left out */
+#define READ_ALL_TIMEOUT_MS 3000
+
 static XdpDbusImplSettings **impls;
+static SettingsCache *caches;
 static int n_impls = 0;
 
+G_LOCK_DEFINE_STATIC (caches);
+
 GType settings_get_type (void) G_GNUC_CONST;
 static void settings_iface_init (XdpDbusSettingsIface *iface);
 
@@ -58,36 +77,396 @@ G_DEFINE_TYPE_WITH_CODE (Settings, settings, XDP_DBUS_TYPE_SETTINGS_SKELETON,
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (Settings, g_object_unref)
 
+static GHashTable *
+namespaces_table_new (void)
+{
+  return g_hash_table_new_full (g_str_hash, g_str_equal,
+                                g_free, (GDestroyNotify) g_hash_table_unref);
+}
+
+static void
+namespaces_table_set (GHashTable *namespaces,
+                      const char *namespace,
+                      const char *key,
+                      GVariant   *value)
+{
+  GHashTable *keys;
+
+  keys = g_hash_table_lookup (namespaces, namespace);
+  if (keys == NULL)
+    {
+      keys = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                    g_free, (GDestroyNotify) g_variant_unref);
+      g_hash_table_insert (namespaces, g_strdup (namespace), keys);
+    }
+
+  g_hash_table_insert (keys, g_strdup (key), g_variant_ref (value));
+}
+
+static void
+namespaces_table_merge (GHashTable *namespaces,
+                        GHashTable *changes)
+{
+  GHashTableIter iter;
+  const char *namespace;
+  GHashTable *keys;
+
+  g_hash_table_iter_init (&iter, changes);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &namespace, (gpointer *) &keys))
+    {
+      GHashTableIter key_iter;
+      const char *key;
+      GVariant *value;
+
+      g_hash_table_iter_init (&key_iter, keys);
+      while (g_hash_table_iter_next (&key_iter, (gpointer *) &key, (gpointer *) &value))
+        namespaces_table_set (namespaces, namespace, key, value);
+    }
+}
+
+static GHashTable *
+namespaces_table_from_variant (GVariant *value)
+{
+  g_autoptr(GHashTable) namespaces = namespaces_table_new ();
+  g_autoptr(GVariantIter) keys_iter = NULL;
+  GVariantIter iter;
+  const char *namespace;
+
+  g_variant_iter_init (&iter, value);
+  while (g_variant_iter_next (&iter, "{&sa{sv}}", &namespace, &keys_iter))
+    {
+      const char *key;
+      GVariant *key_value;
+
+      while (g_variant_iter_next (keys_iter, "{&s@v}", &key, &key_value))
+        {
+          namespaces_table_set (namespaces, namespace, key, key_value);
+          g_variant_unref (key_value);
+        }
+
+      g_clear_pointer (&keys_iter, g_variant_iter_free);
+    }
+
+  return g_steal_pointer (&namespaces);
+}
+
+/* Same matching as the backends do for ReadAll() */
+static gboolean
+namespace_matches (const char         *namespace,
+                   const char * const *patterns)
+{
+  size_t i;
+
+  if (patterns[0] == NULL)
+    return TRUE;
+
+  for (i = 0; patterns[i]; i++)
+    {
+      const char *pattern = patterns[i];
+      size_t pattern_len = strlen (pattern);
+
+      if (pattern_len == 0)
+        return TRUE;
+
+      if (pattern[pattern_len - 1] == '*')
+        {
+          if (strncmp (namespace, pattern, pattern_len - 1) == 0)
+            return TRUE;
+        }
+      else if (strcmp (namespace, pattern) == 0)
+        {
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+static int
+find_impl (XdpDbusImplSettings *impl)
+{
+  int i;
+
+  for (i = 0; i < n_impls; i++)
+    {
+      if (impls[i] == impl)
+        return i;
+    }
+
+  return -1;
+}
+
+typedef struct
+{
+  int *n_pending;
+  gboolean loads_cache;
+  guint generation;
+  GVariant *value;
+  GError *error;
+} BackendFetch;
+
+static void
+backend_fetch_clear (BackendFetch *fetch)
+{
+  g_clear_pointer (&fetch->value, g_variant_unref);
+  g_clear_error (&fetch->error);
+}
+
+static void
+read_all_done (GObject      *source_object,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+  BackendFetch *fetch = user_data;
+  g_autoptr(GVariant) ret = NULL;
+
+  ret = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), result, &fetch->error);
+  if (ret)
+    g_variant_get (ret, "(@a{sa{sv}})", &fetch->value);
+
+  (*fetch->n_pending)--;
+}
+
+static void
+finish_cache_load (int           i,
+                   BackendFetch *fetch)
+{
+  SettingsCache *cache = &caches[i];
+
+  G_LOCK (caches);
+  /* If the backend was restarted meanwhile, the result may be stale */
+  if (fetch->generation == cache->generation)
+    {
+      if (fetch->value)
+        {
+          g_autoptr(GHashTable) namespaces = NULL;
+
+          namespaces = namespaces_table_from_variant (fetch->value);
+          namespaces_table_merge (namespaces, cache->pending);
+          cache->namespaces = g_steal_pointer (&namespaces);
+        }
+      else if (!g_error_matches (fetch->error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT))
+        {
+          /* Slow backends are retried next time, broken ones aren't */
+          cache->failed = TRUE;
+        }
+    }
+  g_clear_pointer (&cache->pending, g_hash_table_unref);
+  cache->loading = FALSE;
+  G_UNLOCK (caches);
+}
+
+/* Calls ReadAll() on every backend whose settings aren't cached yet, all
+ * at once and each with its own deadline, and caches the results. If
+ * @include_uncacheable is FALSE, backends that failed to load before are
+ * skipped. Backends that are already being loaded by another thread are
+ * queried without updating their cache.
+ */
+static void
+fetch_settings (BackendFetch *fetches,
+                gboolean      include_uncacheable)
+{
+  g_autoptr(GMainContext) context = NULL;
+  const char * const all_namespaces[] = { NULL };
+  int n_pending = 0;
+  int i;
+
+  for (i = 0; i < n_impls; i++)
+    {
+      SettingsCache *cache = &caches[i];
+      BackendFetch *fetch = &fetches[i];
+      gboolean needed;
+
+      G_LOCK (caches);
+      needed = cache->namespaces == NULL &&
+               (include_uncacheable || !cache->failed);
+      if (needed && !cache->loading && !cache->failed)
+        {
+          cache->loading = TRUE;
+          cache->pending = namespaces_table_new ();
+          fetch->loads_cache = TRUE;
+          fetch->generation = cache->generation;
+        }
+      G_UNLOCK (caches);
+
+      if (!needed)
+        continue;
+
+      /* Replies are dispatched here, rather than in the main thread */
+      if (context == NULL)
+        {
+          context = g_main_context_new ();
+          g_main_context_push_thread_default (context);
+        }
+
+      fetch->n_pending = &n_pending;
+      n_pending++;
+
+      g_dbus_proxy_call (G_DBUS_PROXY (impls[i]),
+                         "ReadAll",
+                         g_variant_new ("(^as)", all_namespaces),
+                         G_DBUS_CALL_FLAGS_NONE,
+                         READ_ALL_TIMEOUT_MS,
+                         NULL,
+                         read_all_done,
+                         fetch);
+    }
+
+  if (context == NULL)
+    return;
+
+  while (n_pending > 0)
+    g_main_context_iteration (context, TRUE);
+
+  g_main_context_pop_thread_default (context);
+
+  for (i = 0; i < n_impls; i++)
+    {
+      BackendFetch *fetch = &fetches[i];
+
+      if (g_error_matches (fetch->error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT))
+        g_warning ("Settings implementation %s did not reply to ReadAll() in time, "
+                   "leaving out its settings",
+                   g_dbus_proxy_get_name (G_DBUS_PROXY (impls[i])));
+      else if (fetch->error)
+        g_warning ("Failed to ReadAll() from Settings implementation %s: %s",
+                   g_dbus_proxy_get_name (G_DBUS_PROXY (impls[i])),
+                   fetch->error->message);
+
+      if (fetch->loads_cache)
+        finish_cache_load (i, fetch);
+    }
+}
+
+static GVariant *
+lookup_setting (const char *namespace,
+                const char *key)
+{
+  g_autofree BackendFetch *fetches = g_new0 (BackendFetch, n_impls);
+  g_autoptr(GVariant) value = NULL;
+  int i;
+
+  fetch_settings (fetches, FALSE);
+
+  for (i = 0; i < n_impls && value == NULL; i++)
+    {
+      g_autoptr(GError) error = NULL;
+      gboolean cached;
+
+      G_LOCK (caches);
+      cached = caches[i].namespaces != NULL;
+      if (cached)
+        {
+          GHashTable *keys = g_hash_table_lookup (caches[i].namespaces, namespace);
+
+          if (keys)
+            value = g_hash_table_lookup (keys, key);
+          if (value)
+            g_variant_ref (value);
+        }
+      G_UNLOCK (caches);
+
+      if (value)
+        break;
+
+      if (!cached && fetches[i].value)
+        {
+          g_autoptr(GVariant) keys = NULL;
+          g_autoptr(GVariant) key_value = NULL;
+
+          keys = g_variant_lookup_value (fetches[i].value, namespace, G_VARIANT_TYPE_VARDICT);
+          if (keys)
+            key_value = g_variant_lookup_value (keys, key, NULL);
+          if (key_value)
+            {
+              value = g_variant_ref_sink (g_variant_new_variant (key_value));
+              break;
+            }
+        }
+      else if (!cached && g_error_matches (fetches[i].error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT))
+        {
+          /* A backend that didn't answer in time is skipped, as in ReadAll() */
+          continue;
+        }
+
+      /* Backends may answer Read() for keys that ReadAll() doesn't list */
+      if (!xdp_dbus_impl_settings_call_read_sync (impls[i], namespace,
+                                                  key, &value, NULL, &error))
+        {
+          /* A key not being found is expected, continue to our implementation */
+          g_debug ("Failed to Read() from Settings implementation: %s", error->message);
+        }
+    }
+
+  for (i = 0; i < n_impls; i++)
+    backend_fetch_clear (&fetches[i]);
+
+  return g_steal_pointer (&value);
+}
+
+static void
+add_settings (GVariantBuilder    *builder,
+              GHashTable         *namespaces,
+              const char * const *arg_namespaces)
+{
+  GHashTableIter iter;
+  const char *namespace;
+  GHashTable *keys;
+
+  g_hash_table_iter_init (&iter, namespaces);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &namespace, (gpointer *) &keys))
+    {
+      GHashTableIter key_iter;
+      const char *key;
+      GVariant *value;
+
+      if (!namespace_matches (namespace, arg_namespaces))
+        continue;
+
+      g_variant_builder_open (builder, G_VARIANT_TYPE ("{sa{sv}}"));
+      g_variant_builder_add (builder, "s", namespace);
+      g_variant_builder_open (builder, G_VARIANT_TYPE_VARDICT);
+
+      g_hash_table_iter_init (&key_iter, keys);
+      while (g_hash_table_iter_next (&key_iter, (gpointer *) &key, (gpointer *) &value))
+        g_variant_builder_add (builder, "{s@v}", key, value);
+
+      g_variant_builder_close (builder);
+      g_variant_builder_close (builder);
+    }
+}
+
 static gboolean
 settings_handle_read_all (XdpDbusSettings       *object,
                           GDBusMethodInvocation *invocation,
                           const char    * const *arg_namespaces)
 {
   g_autoptr(GVariantBuilder) builder = g_variant_builder_new (G_VARIANT_TYPE ("(a{sa{sv}})"));
+  g_autofree BackendFetch *fetches = g_new0 (BackendFetch, n_impls);
   int j;
 
+  fetch_settings (fetches, TRUE);
+
   g_variant_builder_open (builder, G_VARIANT_TYPE ("a{sa{sv}}"));
 
   for (j = 0; j < n_impls; j++)
     {
-      g_autoptr(GError) error = NULL;
-      g_autoptr(GVariant) impl_value = NULL;
+      BackendFetch *fetch = &fetches[j];
+      gboolean cached;
 
-      if (!xdp_dbus_impl_settings_call_read_all_sync (impls[j], arg_namespaces,
-                                                      &impl_value, NULL, &error))
-        {
-          g_warning ("Failed to ReadAll() from Settings implementation: %s", error->message);
-        }
-      else
+      G_LOCK (caches);
+      cached = caches[j].namespaces != NULL;
+      if (cached)
+        add_settings (builder, caches[j].namespaces, arg_namespaces);
+      G_UNLOCK (caches);
+
+      if (!cached && fetch->value)
         {
-          size_t i;
+          g_autoptr(GHashTable) namespaces = namespaces_table_from_variant (fetch->value);
 
-          for (i = 0; i < g_variant_n_children (impl_value); ++i)
-            {
-              g_autoptr(GVariant) child = g_variant_get_child_value (impl_value, i);
-              g_variant_builder_add_value (builder, child);
-            }
+          add_settings (builder, namespaces, arg_namespaces);
         }
+      backend_fetch_clear (fetch);
     }
 
   g_variant_builder_close (builder);
@@ -103,26 +482,15 @@ settings_handle_read (XdpDbusSettings       *object,
                       const char            *arg_namespace,
                       const char            *arg_key)
 {
-  int i;
+  g_autoptr(GVariant) value = NULL;
 
   g_debug ("Read %s %s", arg_namespace, arg_key);
 
- for (i = 0; i < n_impls; i++)
+  value = lookup_setting (arg_namespace, arg_key);
+  if (value)
     {
-      g_autoptr(GError) error = NULL;
-      g_autoptr(GVariant) impl_value = NULL;
-
-      if (!xdp_dbus_impl_settings_call_read_sync (impls[i], arg_namespace,
-                                                  arg_key, &impl_value, NULL, &error))
-        {
-          /* A key not being found is expected, continue to our implementation */
-          g_debug ("Failed to Read() from Settings implementation: %s", error->message);
-        }
-      else
-        {
-          g_dbus_method_invocation_return_value (invocation, g_variant_new ("(v)", impl_value));
-          return G_DBUS_METHOD_INVOCATION_HANDLED;
-        }
+      g_dbus_method_invocation_return_value (invocation, g_variant_new ("(v)", value));
+      return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
   g_debug ("Attempted to read unknown namespace/key pair: %s %s", arg_namespace, arg_key);
@@ -139,26 +507,15 @@ settings_handle_read_one (XdpDbusSettings       *object,
                           const char            *arg_namespace,
                           const char            *arg_key)
 {
-  int i;
+  g_autoptr(GVariant) value = NULL;
 
   g_debug ("ReadOne %s %s", arg_namespace, arg_key);
 
-  for (i = 0; i < n_impls; i++)
+  value = lookup_setting (arg_namespace, arg_key);
+  if (value)
     {
-      g_autoptr(GError) error = NULL;
-      g_autoptr(GVariant) impl_value = NULL;
-
-      if (!xdp_dbus_impl_settings_call_read_sync (impls[i], arg_namespace,
-                                                  arg_key, &impl_value, NULL, &error))
-        {
-          /* A key not being found is expected, continue to our implementation */
-          g_debug ("Failed to Read() from Settings implementation: %s", error->message);
-        }
-      else
-        {
-          g_dbus_method_invocation_return_value (invocation, g_variant_new_tuple (&impl_value, 1));
-          return G_DBUS_METHOD_INVOCATION_HANDLED;
-        }
+      g_dbus_method_invocation_return_value (invocation, g_variant_new_tuple (&value, 1));
+      return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
   g_debug ("Attempted to read unknown namespace/key pair: %s %s", arg_namespace, arg_key);
@@ -176,11 +533,47 @@ on_impl_settings_changed (XdpDbusImplSettings *impl,
                           GVariant            *arg_value,
                           XdpDbusSettings     *settings)
 {
+  int i = find_impl (impl);
+
+  if (i >= 0)
+    {
+      SettingsCache *cache = &caches[i];
+
+      G_LOCK (caches);
+      if (cache->namespaces)
+        namespaces_table_set (cache->namespaces, arg_namespace, arg_key, arg_value);
+      else if (cache->pending)
+        namespaces_table_set (cache->pending, arg_namespace, arg_key, arg_value);
+      G_UNLOCK (caches);
+    }
+
   g_debug ("Emitting changed for %s %s", arg_namespace, arg_key);
   xdp_dbus_settings_emit_setting_changed (settings, arg_namespace,
                                           arg_key, arg_value);
 }
 
+static void
+on_impl_name_owner_changed (GObject    *object,
+                            GParamSpec *pspec,
+                            gpointer    user_data)
+{
+  int i = find_impl (XDP_DBUS_IMPL_SETTINGS (object));
+  SettingsCache *cache;
+
+  if (i < 0)
+    return;
+
+  g_debug ("Settings implementation changed owner, dropping its cache");
+
+  cache = &caches[i];
+
+  G_LOCK (caches);
+  g_clear_pointer (&cache->namespaces, g_hash_table_unref);
+  cache->failed = FALSE;
+  cache->generation++;
+  G_UNLOCK (caches);
+}
+
 static void
 settings_iface_init (XdpDbusSettingsIface *iface)
 {
@@ -204,6 +597,11 @@ settings_finalize (GObject *object)
   for (i = 0; i < n_impls; i++)
     g_signal_handlers_disconnect_by_data (impls[i], self);
 
+  G_LOCK (caches);
+  for (i = 0; i < n_impls; i++)
+    g_clear_pointer (&caches[i].namespaces, g_hash_table_unref);
+  G_UNLOCK (caches);
+
   G_OBJECT_CLASS (settings_parent_class)->finalize (object);
 }
 
@@ -226,6 +624,7 @@ settings_create (GDBusConnection *connection,
 
   n_impls_tmp = implementations->len;
   impls = g_new (XdpDbusImplSettings *, n_impls_tmp);
+  caches = g_new0 (SettingsCache, n_impls_tmp);
 
   settings = g_object_new (settings_get_type (), NULL);
 
@@ -249,6 +648,7 @@ settings_create (GDBusConnection *connection,
         {
           impls[n_impls++] = impl_proxy;
           g_signal_connect (impl_proxy, "setting-changed", G_CALLBACK (on_impl_settings_changed), settings);
+          g_signal_connect (impl_proxy, "notify::g-name-owner", G_CALLBACK (on_impl_name_owner_changed), settings);
         }
     }
 
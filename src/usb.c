@@ -54,6 +54,10 @@
 #define PERMISSION_ID "usb"
 #define MAX_DEVICES 8
 
+/* Unplugging a hub, or resetting it, sends a burst of uevents. The events
+ * for a session are collected for a little while, and sent together. */
+#define DEVICE_EVENTS_DELAY_MS 100
+
 /* TODO:
  *
  * AccessDevices()
@@ -70,9 +74,11 @@ struct _XdpUsb
   GHashTable *syspaths_to_ids;
 
   GHashTable *sessions;
+  GHashTable *sessions_index; /* index key → GPtrArray of XdpUsbSession */
   GHashTable *sender_infos;
 
   GUdevClient *gudev_client;
+  guint device_events_id;
 };
 
 #define XDP_TYPE_USB (xdp_usb_get_type ())
@@ -88,6 +94,9 @@ struct _XdpUsbSession
   XdpSession parent;
 
   GHashTable *available_devices;
+
+  GArray *index_keys;
+  GPtrArray *pending_events; /* (ssa{sv}) */
 };
 
 #define XDP_TYPE_USB_SESSION (xdp_usb_session_get_type ())
@@ -344,108 +353,130 @@ usb_sender_info_set_device_permission (UsbSenderInfo *sender_info,
                            PERMISSION_TABLE, permission_id, permission);
 }
 
+static void
+parse_hex_field (const char             *value,
+                 size_t                  expected_length,
+                 XdpUsbDeviceDescriptor *descriptor,
+                 XdpUsbDeviceFields      field,
+                 uint16_t               *out_value)
+{
+  if (value != NULL && xdp_validate_hex_uint16 (value, expected_length, out_value))
+    descriptor->fields |= field;
+}
+
+G_LOCK_DEFINE_STATIC (descriptors);
+
+/* Devices are matched against the queries of every sender, so their
+ * identifiers are parsed once per GUdevDevice, i.e. once per uevent */
+static void
+usb_device_get_descriptor (GUdevDevice            *device,
+                           XdpUsbDeviceDescriptor *out_descriptor)
+{
+  static GQuark descriptor_quark = 0;
+  XdpUsbDeviceDescriptor *descriptor;
+
+  if (G_UNLIKELY (descriptor_quark == 0))
+    descriptor_quark = g_quark_from_static_string ("xdp-usb-device-descriptor");
+
+  G_LOCK (descriptors);
+
+  descriptor = g_object_get_qdata (G_OBJECT (device), descriptor_quark);
+  if (descriptor)
+    {
+      *out_descriptor = *descriptor;
+      G_UNLOCK (descriptors);
+      return;
+    }
+
+  descriptor = g_new0 (XdpUsbDeviceDescriptor, 1);
+
+  parse_hex_field (g_udev_device_get_property (device, "ID_VENDOR_ID"), 4,
+                   descriptor, XDP_USB_DEVICE_FIELD_VENDOR_ID,
+                   &descriptor->vendor_id);
+  parse_hex_field (g_udev_device_get_property (device, "ID_MODEL_ID"), 4,
+                   descriptor, XDP_USB_DEVICE_FIELD_PRODUCT_ID,
+                   &descriptor->product_id);
+  parse_hex_field (g_udev_device_get_sysfs_attr (device, "bDeviceClass"), 2,
+                   descriptor, XDP_USB_DEVICE_FIELD_CLASS,
+                   &descriptor->device_class);
+  parse_hex_field (g_udev_device_get_sysfs_attr (device, "bDeviceSubclass"), 2,
+                   descriptor, XDP_USB_DEVICE_FIELD_SUBCLASS,
+                   &descriptor->device_subclass);
+
+  g_object_set_qdata_full (G_OBJECT (device), descriptor_quark, descriptor, g_free);
+  *out_descriptor = *descriptor;
+
+  G_UNLOCK (descriptors);
+}
+
 static gboolean
 usb_sender_info_match_device (UsbSenderInfo *sender_info,
                               GUdevDevice   *device)
 {
-  const char *device_subclass_str = NULL;
-  const char *device_class_str = NULL;
-  const char *product_id_str = NULL;
-  const char *vendor_id_str = NULL;
-  gboolean device_has_product_id = FALSE;
-  gboolean device_has_vendor_id = FALSE;
-  gboolean device_has_subclass = FALSE;
-  gboolean device_has_class = FALSE;
+  XdpUsbDeviceDescriptor descriptor;
+  const XdpUsbMatcher *matcher;
   XdpPermission permission;
-  uint16_t device_product_id;
-  uint16_t device_vendor_id;
-  uint16_t device_subclass;
-  uint16_t device_class;
-  gboolean match = FALSE;
-  const GPtrArray *queries = NULL;
+
+  usb_device_get_descriptor (device, &descriptor);
+
+  /* Matching is cheap, unlike looking up the permission */
+  matcher = xdp_app_info_get_usb_matcher (sender_info->app_info);
+  if (!xdp_usb_matcher_match (matcher, &descriptor))
+    return FALSE;
 
   permission = usb_sender_info_get_device_permission (sender_info, device);
   if (permission == XDP_PERMISSION_NO)
     return FALSE;
 
-  vendor_id_str = g_udev_device_get_property (device, "ID_VENDOR_ID");
-  if (vendor_id_str != NULL && xdp_validate_hex_uint16 (vendor_id_str, 4, &device_vendor_id))
-    device_has_vendor_id = TRUE;
-
-  product_id_str = g_udev_device_get_property (device, "ID_MODEL_ID");
-  if (product_id_str != NULL && xdp_validate_hex_uint16 (product_id_str, 4, &device_product_id))
-    device_has_product_id = TRUE;
+  return TRUE;
+}
 
-  device_class_str = g_udev_device_get_sysfs_attr (device, "bDeviceClass");
-  if (device_class_str != NULL && xdp_validate_hex_uint16 (device_class_str, 2, &device_class))
-    device_has_class = TRUE;
+static void
+index_session (XdpUsb              *self,
+               XdpUsbSession       *usb_session,
+               const XdpUsbMatcher *matcher)
+{
+  g_assert (usb_session->index_keys == NULL);
 
-  device_subclass_str = g_udev_device_get_sysfs_attr (device, "bDeviceSubclass");
-  if (device_subclass_str != NULL && xdp_validate_hex_uint16 (device_subclass_str, 2, &device_subclass))
-    device_has_subclass = TRUE;
+  usb_session->index_keys = xdp_usb_matcher_get_index_keys (matcher);
 
-  queries = xdp_app_info_get_usb_queries (sender_info->app_info);
-  for (size_t i = 0; queries && i < queries->len; i++)
+  for (size_t i = 0; i < usb_session->index_keys->len; i++)
     {
-      XdpUsbQuery *query = g_ptr_array_index (queries, i);
-      gboolean query_matches = TRUE;
+      gpointer key = GUINT_TO_POINTER (g_array_index (usb_session->index_keys, guint, i));
+      GPtrArray *sessions;
 
-      if (!query)
+      sessions = g_hash_table_lookup (self->sessions_index, key);
+      if (!sessions)
         {
-          g_debug ("query %ld is null", i);
-          continue;
+          sessions = g_ptr_array_new ();
+          g_hash_table_insert (self->sessions_index, key, sessions);
         }
 
-      for (size_t j = 0; j < query->rules->len; j++)
-        {
-          XdpUsbRule *rule = g_ptr_array_index (query->rules, j);
-
-          switch (rule->rule_type)
-            {
-            case XDP_USB_RULE_TYPE_ALL:
-              query_matches = TRUE;
-              break;
-
-            case XDP_USB_RULE_TYPE_CLASS:
-              query_matches &= device_has_class &&
-                               device_class == rule->d.device_class.class;
-
-              if (rule->d.device_class.type == XDP_USB_RULE_CLASS_TYPE_CLASS_SUBCLASS)
-                query_matches &= device_has_subclass &&
-                                 device_subclass == rule->d.device_class.subclass;
-
-              break;
+      g_ptr_array_add (sessions, usb_session);
+    }
+}
 
-            case XDP_USB_RULE_TYPE_DEVICE:
-              query_matches &= device_has_product_id &&
-                               device_product_id == rule->d.product.id;
-              break;
+static void
+unindex_session (XdpUsb        *self,
+                 XdpUsbSession *usb_session)
+{
+  if (!usb_session->index_keys)
+    return;
 
-            case XDP_USB_RULE_TYPE_VENDOR:
-              query_matches &= device_has_vendor_id &&
-                               device_vendor_id == rule->d.vendor.id;
-              break;
+  for (size_t i = 0; i < usb_session->index_keys->len; i++)
+    {
+      gpointer key = GUINT_TO_POINTER (g_array_index (usb_session->index_keys, guint, i));
+      GPtrArray *sessions;
 
-            default:
-              g_assert_not_reached ();
-            }
-        }
+      sessions = g_hash_table_lookup (self->sessions_index, key);
+      g_assert (sessions != NULL);
 
-      switch (query->query_type)
-        {
-        case XDP_USB_QUERY_TYPE_ENUMERABLE:
-          if (query_matches)
-            match = TRUE;
-          break;
-
-        case XDP_USB_QUERY_TYPE_HIDDEN:
-          if (query_matches)
-            return FALSE;
-          break;
-        }
+      g_ptr_array_remove_fast (sessions, usb_session);
+      if (sessions->len == 0)
+        g_hash_table_remove (self->sessions_index, key);
     }
 
-  return match;
+  g_clear_pointer (&usb_session->index_keys, g_array_unref);
 }
 
 static void
@@ -454,6 +485,7 @@ xdp_usb_session_close (XdpSession *session)
   g_debug ("USB session '%s' closed", session->id);
 
   g_assert (g_hash_table_contains (usb->sessions, session));
+  unindex_session (usb, XDP_USB_SESSION (session));
   g_hash_table_remove (usb->sessions, session);
 }
 
@@ -463,6 +495,8 @@ xdp_usb_session_dispose (GObject *object)
   XdpUsbSession *usb_session = XDP_USB_SESSION (object);
 
   g_clear_pointer (&usb_session->available_devices, g_hash_table_destroy);
+  g_clear_pointer (&usb_session->index_keys, g_array_unref);
+  g_clear_pointer (&usb_session->pending_events, g_ptr_array_unref);
 }
 
 static void
@@ -480,6 +514,7 @@ static void
 xdp_usb_session_init (XdpUsbSession *session)
 {
   session->available_devices = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  session->pending_events = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
 }
 
 static XdpUsbSession *
@@ -505,14 +540,12 @@ xdp_usb_session_new (GDBusConnection  *connection,
   return XDP_USB_SESSION (session);
 }
 
+/* The parts of the device variant that are the same for every sender */
 static GVariant *
-gudev_device_to_variant (XdpUsb        *self,
-                         UsbSenderInfo *sender_info,
-                         GUdevDevice   *device)
+gudev_device_to_base_variant (GUdevDevice *device)
 {
   g_auto(GVariantDict) udev_properties_dict = G_VARIANT_DICT_INIT (NULL);
   g_auto(GVariantDict) device_variant_dict = G_VARIANT_DICT_INIT (NULL);
-  g_autoptr(GUdevDevice) parent = NULL;
   const char *device_file = NULL;
   size_t n_added_properties = 0;
 
@@ -534,21 +567,6 @@ gudev_device_to_variant (XdpUsb        *self,
   if (!is_gudev_device_suitable (device))
     return NULL;
 
-  parent = g_udev_device_get_parent (device);
-  if (parent != NULL && usb_sender_info_match_device (sender_info, parent))
-    {
-      const char *parent_syspath = NULL;
-      const char *parent_id = NULL;
-
-      parent_syspath = g_udev_device_get_sysfs_path (parent);
-      if (parent_syspath != NULL)
-        {
-          parent_id = g_hash_table_lookup (self->syspaths_to_ids, parent_syspath);
-          if (parent_id != NULL)
-            g_variant_dict_insert (&device_variant_dict, "parent", "s", parent_id);
-        }
-    }
-
   device_file = g_udev_device_get_device_file (device);
   g_variant_dict_insert (&device_variant_dict, "device-file", "s", device_file);
 
@@ -579,6 +597,54 @@ gudev_device_to_variant (XdpUsb        *self,
   return g_variant_ref_sink (g_variant_dict_end (&device_variant_dict));
 }
 
+/* Adds the parent of @device to @base_variant, if the sender can see it */
+static GVariant *
+device_variant_for_sender (XdpUsb        *self,
+                           UsbSenderInfo *sender_info,
+                           GUdevDevice   *device,
+                           GVariant      *base_variant)
+{
+  g_autoptr(GUdevDevice) parent = NULL;
+  GVariantDict device_variant_dict;
+  GUdevDevice *registered_parent = NULL;
+  const char *parent_syspath = NULL;
+  const char *parent_id = NULL;
+
+  parent = g_udev_device_get_parent (device);
+  if (parent != NULL)
+    parent_syspath = g_udev_device_get_sysfs_path (parent);
+
+  if (parent_syspath != NULL)
+    parent_id = g_hash_table_lookup (self->syspaths_to_ids, parent_syspath);
+
+  /* Match the registered device, its descriptor is already parsed */
+  if (parent_id != NULL)
+    registered_parent = g_hash_table_lookup (self->ids_to_devices, parent_id);
+
+  if (registered_parent == NULL ||
+      !usb_sender_info_match_device (sender_info, registered_parent))
+    return g_variant_ref (base_variant);
+
+  g_variant_dict_init (&device_variant_dict, base_variant);
+  g_variant_dict_insert (&device_variant_dict, "parent", "s", parent_id);
+
+  return g_variant_ref_sink (g_variant_dict_end (&device_variant_dict));
+}
+
+static GVariant *
+gudev_device_to_variant (XdpUsb        *self,
+                         UsbSenderInfo *sender_info,
+                         GUdevDevice   *device)
+{
+  g_autoptr(GVariant) base_variant = NULL;
+
+  base_variant = gudev_device_to_base_variant (device);
+  if (!base_variant)
+    return NULL;
+
+  return device_variant_for_sender (self, sender_info, device, base_variant);
+}
+
 /* Register the device and create a unique ID for it */
 static char *
 register_with_unique_usb_id (XdpUsb       *self,
@@ -607,53 +673,187 @@ register_with_unique_usb_id (XdpUsb       *self,
   return g_steal_pointer (&id);
 }
 
+static gboolean
+send_device_events (gpointer data)
+{
+  XdpUsb *self = XDP_USB (data);
+  GHashTableIter iter;
+  XdpUsbSession *usb_session;
+
+  self->device_events_id = 0;
+
+  g_hash_table_iter_init (&iter, self->sessions);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &usb_session, NULL))
+    {
+      XdpSession *session = XDP_SESSION (usb_session);
+      GVariant *events;
+
+      if (usb_session->pending_events->len == 0)
+        continue;
+
+      events = g_variant_new_array (G_VARIANT_TYPE ("(ssa{sv})"),
+                                    (GVariant **) usb_session->pending_events->pdata,
+                                    usb_session->pending_events->len);
+
+      g_dbus_connection_emit_signal (session->connection,
+                                     session->sender,
+                                     "/org/freedesktop/portal/desktop",
+                                     "org.freedesktop.portal.Usb",
+                                     "DeviceEvents",
+                                     g_variant_new ("(o@a(ssa{sv}))",
+                                                    session->id,
+                                                    events),
+                                     NULL);
+
+      g_ptr_array_set_size (usb_session->pending_events, 0);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
-handle_session_event (XdpUsb        *self,
-                      XdpUsbSession *usb_session,
-                      GUdevDevice   *device,
-                      const char    *id,
-                      const char    *action,
-                      gboolean       removing)
+queue_session_event (XdpUsb        *self,
+                     XdpUsbSession *usb_session,
+                     const char    *action,
+                     const char    *id,
+                     GVariant      *device_variant)
 {
-  g_autoptr(GVariant) device_variant = NULL;
-  GVariantBuilder devices_builder;
-  UsbSenderInfo *sender_info;
-  XdpSession *session;
+  GVariant *event;
+
+  event = g_variant_new ("(ss@a{sv})", action, id, device_variant);
+  g_ptr_array_add (usb_session->pending_events, g_variant_ref_sink (event));
+
+  if (self->device_events_id == 0)
+    self->device_events_id = g_timeout_add (DEVICE_EVENTS_DELAY_MS,
+                                            send_device_events,
+                                            self);
+}
+
+/* Sessions that may have to be told about the event, i.e. the ones the
+ * device was available to when it is being removed, and otherwise the
+ * ones with a query for its vendor or class. */
+static GPtrArray *
+find_event_sessions (XdpUsb      *self,
+                     GUdevDevice *device,
+                     const char  *id,
+                     gboolean     removing)
+{
+  GPtrArray *event_sessions;
+  GHashTableIter iter;
+  XdpUsbSession *usb_session;
+
+  event_sessions = g_ptr_array_new ();
+
+  if (removing)
+    {
+      g_hash_table_iter_init (&iter, self->sessions);
+      while (g_hash_table_iter_next (&iter, (gpointer *) &usb_session, NULL))
+        {
+          if (g_hash_table_contains (usb_session->available_devices, id))
+            g_ptr_array_add (event_sessions, usb_session);
+        }
+    }
+  else
+    {
+      guint keys[XDP_USB_MAX_DEVICE_INDEX_KEYS];
+      XdpUsbDeviceDescriptor descriptor;
+      size_t n_keys;
+
+      usb_device_get_descriptor (device, &descriptor);
+      n_keys = xdp_usb_device_descriptor_get_index_keys (&descriptor, keys);
+
+      for (size_t i = 0; i < n_keys; i++)
+        {
+          GPtrArray *sessions;
+
+          sessions = g_hash_table_lookup (self->sessions_index, GUINT_TO_POINTER (keys[i]));
+          if (!sessions)
+            continue;
+
+          /* A session is filed under more than one key when its queries
+           * name several vendors or classes */
+          for (size_t j = 0; j < sessions->len; j++)
+            {
+              usb_session = g_ptr_array_index (sessions, j);
+              if (!g_ptr_array_find (event_sessions, usb_session, NULL))
+                g_ptr_array_add (event_sessions, usb_session);
+            }
+        }
+    }
+
+  return event_sessions;
+}
+
+static void
+handle_device_event (XdpUsb      *self,
+                     GUdevDevice *device,
+                     const char  *id,
+                     const char  *action,
+                     gboolean     removing)
+{
+  g_autoptr(GPtrArray) event_sessions = NULL;
+  g_autoptr(GHashTable) sender_variants = NULL;
+  g_autoptr(GPtrArray) device_variants = NULL;
+  g_autoptr(GVariant) base_variant = NULL;
 
   g_assert (G_UDEV_IS_DEVICE (device));
   g_assert (g_strcmp0 (g_udev_device_get_subsystem (device), "usb") == 0);
 
-  session = XDP_SESSION (usb_session);
-  sender_info = g_hash_table_lookup (self->sender_infos, session->sender);
-  g_assert (sender_info != NULL);
+  event_sessions = find_event_sessions (self, device, id, removing);
+  if (event_sessions->len == 0)
+    return;
 
-  /* We can't use usb_sender_info_match_device() when a device is being removed because,
-   * on removal, the only property the GUdevDevice has is its sysfs path.
-   * Check if this device was previously available to the USB session
-   * instead. */
-  if ((removing && !g_hash_table_contains (usb_session->available_devices, id)) ||
-      (!removing && !usb_sender_info_match_device (sender_info, device)))
+  base_variant = gudev_device_to_base_variant (device);
+  if (!base_variant)
     return;
 
-  g_variant_builder_init (&devices_builder, G_VARIANT_TYPE ("a(ssa{sv})"));
+  /* Apps often have more than one session, so the device is matched, and
+   * its variant built, once per sender. A NULL variant means that the
+   * sender can't see the device. */
+  sender_variants = g_hash_table_new (NULL, NULL);
+  device_variants = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
 
-  device_variant = gudev_device_to_variant (self, sender_info, device);
-  g_variant_builder_add (&devices_builder, "(ss@a{sv})", action, id, device_variant);
+  for (size_t i = 0; i < event_sessions->len; i++)
+    {
+      XdpUsbSession *usb_session = g_ptr_array_index (event_sessions, i);
+      XdpSession *session = XDP_SESSION (usb_session);
+      UsbSenderInfo *sender_info;
+      GVariant *device_variant;
 
-  g_dbus_connection_emit_signal (session->connection,
-                                 session->sender,
-                                 "/org/freedesktop/portal/desktop",
-                                 "org.freedesktop.portal.Usb",
-                                 "DeviceEvents",
-                                 g_variant_new ("(o@a(ssa{sv}))",
-                                                session->id,
-                                                g_variant_builder_end (&devices_builder)),
-                                 NULL);
+      sender_info = g_hash_table_lookup (self->sender_infos, session->sender);
+      g_assert (sender_info != NULL);
 
-  if (removing)
-    g_hash_table_remove (usb_session->available_devices, id);
-  else
-    g_hash_table_add (usb_session->available_devices, g_strdup (id));
+      if (!g_hash_table_lookup_extended (sender_variants, sender_info,
+                                         NULL, (gpointer *) &device_variant))
+        {
+          /* We can't use usb_sender_info_match_device() when a device is
+           * being removed because, on removal, the only property the
+           * GUdevDevice has is its sysfs path. The session was found
+           * because the device was available to it instead. */
+          if (removing || usb_sender_info_match_device (sender_info, device))
+            {
+              device_variant = device_variant_for_sender (self, sender_info,
+                                                          device, base_variant);
+              g_ptr_array_add (device_variants, device_variant);
+            }
+          else
+            {
+              device_variant = NULL;
+            }
+
+          g_hash_table_insert (sender_variants, sender_info, device_variant);
+        }
+
+      if (!device_variant)
+        continue;
+
+      queue_session_event (self, usb_session, action, id, device_variant);
+
+      if (removing)
+        g_hash_table_remove (usb_session->available_devices, id);
+      else
+        g_hash_table_add (usb_session->available_devices, g_strdup (id));
+    }
 }
 
 static void
@@ -670,8 +870,6 @@ gudev_client_uevent_cb (GUdevClient *client,
   };
 
   g_autofree char *id = NULL;
-  GHashTableIter iter;
-  XdpUsbSession *usb_session;
   const char *syspath = NULL;
   gboolean removing;
 
@@ -698,9 +896,7 @@ gudev_client_uevent_cb (GUdevClient *client,
   g_assert (id != NULL);
 
   /* Send event to all sessions that are allowed to handle it */
-  g_hash_table_iter_init (&iter, self->sessions);
-  while (g_hash_table_iter_next (&iter, (gpointer *) &usb_session, NULL))
-    handle_session_event (self, usb_session, device, id, action, removing);
+  handle_device_event (self, device, id, action, removing);
 
   if (removing)
     {
@@ -849,6 +1045,7 @@ handle_create_session (XdpDbusUsb            *object,
 
   g_debug ("New USB session registered: %s",  session->id);
   g_hash_table_add (self->sessions, usb_session);
+  index_session (self, usb_session, xdp_app_info_get_usb_matcher (call->app_info));
 
   xdp_dbus_usb_complete_create_session (object, invocation, session->id);
 
@@ -1154,7 +1351,7 @@ handle_acquire_devices (XdpDbusUsb            *object,
                         GVariant              *arg_devices,
                         GVariant              *arg_options)
 {
-  g_autoptr(XdpDbusImplRequest) impl_request = NULL;
+  g_autoptr(XdpImplRequest) impl_request = NULL;
   g_autoptr(UsbSenderInfo) sender_info = NULL;
   g_autoptr(GVariant) filtered_devices = NULL;
   g_autoptr(GVariant) options = NULL;
@@ -1186,17 +1383,7 @@ handle_acquire_devices (XdpDbusUsb            *object,
       return G_DBUS_METHOD_INVOCATION_HANDLED;
     }
 
-  impl_request = xdp_dbus_impl_request_proxy_new_sync (g_dbus_proxy_get_connection (G_DBUS_PROXY (usb_impl)),
-                                                       G_DBUS_PROXY_FLAGS_NONE,
-                                                       g_dbus_proxy_get_name (G_DBUS_PROXY (usb_impl)),
-                                                       request->id,
-                                                       NULL,
-                                                       &error);
-  if (!impl_request)
-    {
-      g_dbus_method_invocation_return_gerror (invocation, error);
-      return G_DBUS_METHOD_INVOCATION_HANDLED;
-    }
+  impl_request = xdp_impl_request_new (G_DBUS_PROXY (usb_impl), request->id);
 
   g_variant_builder_init (&options_builder, G_VARIANT_TYPE_VARDICT);
   if (!xdp_filter_options (arg_options,
@@ -1475,6 +1662,8 @@ xdp_usb_dispose (GObject *object)
   g_clear_pointer (&self->ids_to_devices, g_hash_table_unref);
   g_clear_pointer (&self->syspaths_to_ids, g_hash_table_unref);
   g_clear_pointer (&self->sessions, g_hash_table_unref);
+  g_clear_pointer (&self->sessions_index, g_hash_table_unref);
+  g_clear_handle_id (&self->device_events_id, g_source_remove);
 
   g_clear_object (&self->gudev_client);
 }
@@ -1505,6 +1694,8 @@ xdp_usb_init (XdpUsb *self)
   self->syspaths_to_ids = g_hash_table_new_full (g_str_hash, g_str_equal,
                                                  g_free, g_free);
   self->sessions = g_hash_table_new (g_direct_hash, g_direct_equal);
+  self->sessions_index = g_hash_table_new_full (NULL, NULL, NULL,
+                                                (GDestroyNotify) g_ptr_array_unref);
   self->sender_infos =
     g_hash_table_new_full (g_str_hash, g_str_equal,
                            g_free, (GDestroyNotify) usb_sender_info_unref);
@@ -32,6 +32,7 @@
 #include <unistd.h>
 
 #include "xdp-utils.h"
+#include "validator-server.h"
 
 #ifdef __FreeBSD__
 #define execvpe exect
@@ -39,6 +40,10 @@
 
 #define ICON_VALIDATOR_GROUP "Icon Validator"
 
+/* Image data is fed to the loader in chunks of this size, so that it can
+ * be rejected as soon as its header has been parsed */
+#define LOAD_CHUNK_SIZE (16 * 1024)
+
 typedef struct
 {
   const char *name;
@@ -67,6 +72,19 @@ static const XdpValidatorRuleset *ruleset = NULL;
 static gboolean opt_sandbox;
 static char *opt_path = NULL;
 static int opt_fd = -1;
+static int opt_socket = -1;
+
+static const XdpValidatorRuleset *
+find_ruleset (const char *name)
+{
+  for (size_t i = 0; i < G_N_ELEMENTS (rulesets); i++)
+    {
+      if (g_strcmp0 (name, rulesets[i].name) == 0)
+        return &rulesets[i];
+    }
+
+  return NULL;
+}
 
 static gboolean
 option_validator_cb (const gchar  *option_name,
@@ -74,14 +92,9 @@ option_validator_cb (const gchar  *option_name,
                      gpointer      data,
                      GError      **error)
 {
-  for (size_t i = 0; i < G_N_ELEMENTS (rulesets); i++)
-    {
-      if (g_strcmp0 (value, rulesets[i].name) == 0)
-        {
-          ruleset = &rulesets[i];
-          return TRUE;
-        }
-    }
+  ruleset = find_ruleset (value);
+  if (ruleset)
+    return TRUE;
 
   g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
                "Invalid ruleset '%s'. Accepted values are: desktop, notification",
@@ -94,22 +107,80 @@ static GOptionEntry entries[] = {
   { "path", 0, 0, G_OPTION_ARG_FILENAME, &opt_path, "Read icon data from given file path. Required to be from a trusted source.", "PATH" },
   { "fd", 0, 0, G_OPTION_ARG_INT, &opt_fd, "Read icon data from given file descriptor. Required to be from a trusted source or to be sealed", "FD" },
   { "ruleset", 0, 0, G_OPTION_ARG_CALLBACK, &option_validator_cb, "The icon validator ruleset to apply. Accepted values: desktop, notification", "RULESET" },
+  { "socket", 0, 0, G_OPTION_ARG_INT, &opt_socket, "Validate icons received on the given socket until it is closed. Each request names the ruleset to apply", "FD" },
   { NULL }
 };
 
+/* Returns why an image of the given format and size is not an acceptable
+ * icon, or NULL if it is */
+static char *
+check_format_and_size (GdkPixbufFormat  *format,
+                       int               width,
+                       int               height,
+                       char            **out_name)
+{
+  const char *allowed_formats[] = { "png", "jpeg", "svg", NULL };
+  g_autofree char *name = NULL;
+  int max_size;
+
+  if (!format)
+    return g_strdup ("Image format not recognized");
+
+  name = gdk_pixbuf_format_get_name (format);
+  if (!g_strv_contains (allowed_formats, name))
+    return g_strdup_printf ("Image format %s not accepted", name);
+
+  if (width != height)
+    return g_strdup_printf ("Expected a square image but got: %dx%d", width, height);
+
+  /* Sanity check for vector files */
+  max_size = g_str_equal (name, "svg") ? ruleset->max_svg_icon_size : ruleset->max_icon_size;
+
+  /* The icon is a square so we only need to check one side */
+  if (width > max_size)
+    return g_strdup_printf ("Image too large (%dx%d). Max. size %dx%d",
+                            width, height, max_size, max_size);
+
+  if (out_name)
+    *out_name = g_steal_pointer (&name);
+
+  return NULL;
+}
+
+static void
+size_prepared_cb (GdkPixbufLoader *loader,
+                  int              width,
+                  int              height,
+                  gpointer         user_data)
+{
+  char **rejection = user_data;
+
+  if (*rejection)
+    return;
+
+  *rejection = check_format_and_size (gdk_pixbuf_loader_get_format (loader),
+                                      width, height, NULL);
+
+  /* Vector images are only rendered when closing the loader, make sure
+   * that a rejected one is not rendered at its full size */
+  if (*rejection)
+    gdk_pixbuf_loader_set_size (loader, 1, 1);
+}
+
 static int
 validate_icon (int input_fd)
 {
-  const char *allowed_formats[] = { "png", "jpeg", "svg", NULL };
   g_autoptr(GBytes) bytes = NULL;
   g_autoptr(GError) error = NULL;
-  GdkPixbufFormat *format;
   g_autoptr(GKeyFile) key_file = NULL;
   g_autofree char *key_file_data = NULL;
   g_autoptr(GdkPixbufLoader) loader = NULL;
   g_autoptr(GMappedFile) mapped = NULL;
-  int max_size, width, height;
+  g_autofree char *rejection = NULL;
+  int width, height;
   g_autofree char *name = NULL;
+  const guchar *data;
+  gsize size, offset;
   GdkPixbuf *pixbuf;
 
   g_assert (ruleset != NULL);
@@ -139,57 +210,58 @@ validate_icon (int input_fd)
     }
 
   loader = gdk_pixbuf_loader_new ();
+  g_signal_connect (loader, "size-prepared", G_CALLBACK (size_prepared_cb), &rejection);
 
-  if (!gdk_pixbuf_loader_write_bytes (loader, bytes, &error))
+  /* Stop as soon as the header tells that the image won't be accepted,
+   * rather than decoding all of it first */
+  data = g_bytes_get_data (bytes, &size);
+  for (offset = 0; offset < size && rejection == NULL; offset += LOAD_CHUNK_SIZE)
     {
-      g_printerr ("Failed to load image: %s\n", error->message);
-      gdk_pixbuf_loader_close (loader, NULL);
-      return 1;
+      if (!gdk_pixbuf_loader_write (loader, data + offset,
+                                    MIN (LOAD_CHUNK_SIZE, size - offset),
+                                    &error))
+        {
+          g_printerr ("Failed to load image: %s\n", error->message);
+          gdk_pixbuf_loader_close (loader, NULL);
+          return 1;
+        }
     }
 
-  if (!gdk_pixbuf_loader_close (loader, &error))
+  if (rejection)
     {
-      g_printerr ("Failed to load image: %s\n", error->message);
+      g_printerr ("%s\n", rejection);
+      gdk_pixbuf_loader_close (loader, NULL);
       return 1;
     }
 
-  pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
-  if (!pixbuf)
+  if (!gdk_pixbuf_loader_close (loader, &error))
     {
       g_printerr ("Failed to load image: %s\n", error->message);
       return 1;
     }
 
-  format = gdk_pixbuf_loader_get_format (loader);
-  if (!format)
+  if (rejection)
     {
-      g_printerr ("Image format not recognized\n");
+      g_printerr ("%s\n", rejection);
       return 1;
     }
 
-  name = gdk_pixbuf_format_get_name (format);
-  if (!g_strv_contains (allowed_formats, name))
+  pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+  if (!pixbuf)
     {
-      g_printerr ("Image format %s not accepted\n", name);
+      g_printerr ("Failed to load image: No image data\n");
       return 1;
     }
 
+  /* Loaders that don't emit size-prepared are only checked here */
   width = gdk_pixbuf_get_width (pixbuf);
   height = gdk_pixbuf_get_height (pixbuf);
 
-  if (width != height)
-    {
-      g_printerr ("Expected a square image but got: %dx%d\n", width, height);
-      return 1;
-    }
-
-  /* Sanity check for vector files */
-  max_size = g_str_equal (name, "svg") ? ruleset->max_svg_icon_size : ruleset->max_icon_size;
-
-  /* The icon is a square so we only need to check one side */
-  if (width > max_size)
+  rejection = check_format_and_size (gdk_pixbuf_loader_get_format (loader),
+                                     width, height, &name);
+  if (rejection)
     {
-      g_printerr ("Image too large (%dx%d). Max. size %dx%d\n", width, height, max_size, max_size);
+      g_printerr ("%s\n", rejection);
       return 1;
     }
 
@@ -206,6 +278,29 @@ validate_icon (int input_fd)
   return 0;
 }
 
+static int
+validate_icon_request (int         input_fd,
+                       const char *request)
+{
+  ruleset = find_ruleset (request);
+  if (ruleset == NULL)
+    {
+      g_printerr ("Invalid ruleset '%s'\n", request);
+      return 1;
+    }
+
+  return validate_icon (input_fd);
+}
+
+static int
+run_server (int socket_fd)
+{
+  /* Load the loaders once, rather than in every child */
+  g_slist_free (gdk_pixbuf_get_formats ());
+
+  return validator_run_server (socket_fd, validate_icon_request);
+}
+
 #ifdef HELPER
 
 G_GNUC_NULL_TERMINATED
@@ -260,7 +355,7 @@ rerun_in_sandbox (int input_fd)
   char validate_icon[PATH_MAX + 1];
   ssize_t symlink_size;
 
-  g_assert (ruleset != NULL);
+  g_assert (ruleset != NULL || opt_socket != -1);
 
   symlink_size = readlink ("/proc/self/exe", validate_icon, sizeof (validate_icon) - 1);
   if (symlink_size < 0 || (size_t) symlink_size >= sizeof (validate_icon))
@@ -321,11 +416,17 @@ rerun_in_sandbox (int input_fd)
     add_args (args, "--setenv", "G_MESSAGES_PREFIXED", g_getenv ("G_MESSAGES_PREFIXED"), NULL);
 
   arg_input_fd = g_strdup_printf ("%d", input_fd);
-  add_args (args,
-            validate_icon,
-            "--fd", arg_input_fd,
-            "--ruleset", ruleset->name,
-            NULL);
+  if (opt_socket != -1)
+    add_args (args,
+              validate_icon,
+              "--socket", arg_input_fd,
+              NULL);
+  else
+    add_args (args,
+              validate_icon,
+              "--fd", arg_input_fd,
+              "--ruleset", ruleset->name,
+              NULL);
   g_ptr_array_add (args, NULL);
 
   execvpe (flatpak_get_bwrap (), (char **) args->pdata, NULL);
@@ -350,6 +451,22 @@ main (int argc, char *argv[])
       return 1;
     }
 
+  if (opt_socket != -1)
+    {
+      if (opt_path != NULL || opt_fd != -1 || ruleset != NULL)
+        {
+          g_printerr ("Error: --socket can't be combined with --path, --fd or --ruleset\n");
+          return 1;
+        }
+
+#ifdef HELPER
+      if (opt_sandbox)
+        return rerun_in_sandbox (opt_socket);
+      else
+#endif
+        return run_server (opt_socket);
+    }
+
   if (ruleset == NULL)
     {
       g_printerr ("Error: A ruleset must be given with --ruleset\n");
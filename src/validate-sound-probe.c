@@ -0,0 +1,43 @@
+/*
+ * Copyright © 2024 GNOME Foundation Inc.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "validate-sound-probe.h"
+
+/* Returns whether @data starts like one of the files the discoverer could
+ * accept. ID3 tags may precede the actual stream, so those are let through
+ * as well.
+ */
+gboolean
+validate_sound_probe_has_known_magic (const guint8 *data,
+                                      gsize         size)
+{
+  const char *magics[] = { "RIFF", "RIFX", "RF64", "BW64", "OggS", "ID3" };
+
+  for (size_t i = 0; i < G_N_ELEMENTS (magics); i++)
+    {
+      size_t len = strlen (magics[i]);
+
+      if (size >= len && memcmp (data, magics[i], len) == 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
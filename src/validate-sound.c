@@ -29,17 +29,57 @@
 #include <glib/gstdio.h>
 #include <unistd.h>
 
+#include "glib-backports.h"
+#include "validate-sound-probe.h"
+#include "validator-server.h"
+
 #ifdef __FreeBSD__
 #define execvpe exect
 #endif
 
 #define SOUND_VALIDATOR_GROUP "Sound Validator"
 
+static gboolean  opt_sandbox;
+static gchar    *opt_path = NULL;
+static gint      opt_fd = -1;
+static gint      opt_socket = -1;
+
+static GOptionEntry entries[] = {
+  { "sandbox", 0, 0, G_OPTION_ARG_NONE, &opt_sandbox, "Run in a sandbox", NULL },
+  { "path", 0, 0, G_OPTION_ARG_FILENAME, &opt_path, "Read sound data from given file path", "PATH" },
+  { "fd", 0, 0, G_OPTION_ARG_INT, &opt_fd, "Read sound data from given file descriptor", "FD" },
+  { "socket", 0, 0, G_OPTION_ARG_INT, &opt_socket, "Validate sounds received on the given socket until it is closed", "FD" },
+  { NULL }
+};
+
+/* Rejects files that can't be in one of the accepted formats without
+ * building a pipeline.
+ */
+static gboolean
+probe_sound_format (int input_fd)
+{
+  g_autoptr(GMappedFile) mapped = NULL;
+  const guint8 *data;
+  gsize size;
+
+  mapped = g_mapped_file_new_from_fd (input_fd, FALSE, NULL);
+  if (!mapped)
+    return TRUE;
+
+  data = (const guint8 *) g_mapped_file_get_contents (mapped);
+  size = g_mapped_file_get_length (mapped);
+
+  return validate_sound_probe_has_known_magic (data, size);
+}
+
+/* Transient failures, like running into the timeout on a loaded system,
+ * return VALIDATOR_EXIT_FAILED rather than 1, so that the sound isn't
+ * remembered as invalid.
+ */
 static int
-validate_sound (int input_fd)
+discover_sound_format (int          input_fd,
+                       const char **out_format)
 {
-  g_autoptr(GKeyFile) key_file = NULL;
-  g_autofree char *key_file_data = NULL;
   g_autoptr(GError) error = NULL;
   g_autoptr(GstDiscoverer) discoverer = NULL;
   g_autoptr(GstDiscovererInfo) info = NULL;
@@ -50,14 +90,12 @@ validate_sound (int input_fd)
   const gchar *format = NULL;
   g_autofree gchar *uri = NULL;
 
-  gst_init (NULL, NULL);
-
   discoverer = gst_discoverer_new (GST_SECOND, &error);
 
   if (!discoverer)
     {
       g_printerr ("validate-sound: Failed to create gstreamer discoverer: %s\n", error->message);
-      return 1;
+      return VALIDATOR_EXIT_FAILED;
     }
 
   uri = g_strdup_printf ("file:///proc/self/fd/%d", input_fd);
@@ -74,10 +112,10 @@ validate_sound (int input_fd)
         return 1;
       case GST_DISCOVERER_TIMEOUT:
         g_printerr ("validate-sound: Couldn't discover media type: Timeout\n");
-        return 1;
+        return VALIDATOR_EXIT_FAILED;
       case GST_DISCOVERER_BUSY:
         g_printerr ("validate-sound: Couldn't discover media type: Busy\n");
-        return 1;
+        return VALIDATOR_EXIT_FAILED;
       case GST_DISCOVERER_MISSING_PLUGINS:
         {
           g_autofree char *str = NULL;
@@ -86,7 +124,7 @@ validate_sound (int input_fd)
                             (char **) gst_discoverer_info_get_missing_elements_installer_details (info));
 
           g_printerr ("validate-sound: Couldn't discover media type: Missing plugins: %s\n", str);
-          return 1;
+          return VALIDATOR_EXIT_FAILED;
         }
       case GST_DISCOVERER_OK:
         break;
@@ -176,6 +214,31 @@ validate_sound (int input_fd)
       return 1;
     }
 
+  *out_format = format;
+
+  return 0;
+}
+
+static int
+validate_sound (int input_fd)
+{
+  g_autoptr(GKeyFile) key_file = NULL;
+  g_autofree char *key_file_data = NULL;
+  const char *format;
+  int ret;
+
+  if (!probe_sound_format (input_fd))
+    {
+      g_printerr ("validate-sound: Unsupported sound format\n");
+      return 1;
+    }
+
+  gst_init (NULL, NULL);
+
+  ret = discover_sound_format (input_fd, &format);
+  if (ret != 0)
+    return ret;
+
   key_file = g_key_file_new ();
   g_key_file_set_string (key_file, SOUND_VALIDATOR_GROUP, "format", format);
   key_file_data = g_key_file_to_data (key_file, NULL, NULL);
@@ -186,6 +249,23 @@ validate_sound (int input_fd)
   return 0;
 }
 
+static int
+validate_sound_request (int         input_fd,
+                        const char *request)
+{
+  return validate_sound (input_fd);
+}
+
+static int
+run_server (int socket_fd)
+{
+  /* Loading the registry is what makes validating a sound expensive, so
+   * it is only done once, before serving any request */
+  gst_init (NULL, NULL);
+
+  return validator_run_server (socket_fd, validate_sound_request);
+}
+
 #ifdef HELPER
 
 G_GNUC_NULL_TERMINATED
@@ -301,7 +381,10 @@ rerun_in_sandbox (int input_fd)
 
 
   arg_input_fd = g_strdup_printf ("%d", input_fd);
-  add_args (args, validate_sound, "--fd", arg_input_fd, NULL);
+  if (opt_socket != -1)
+    add_args (args, validate_sound, "--socket", arg_input_fd, NULL);
+  else
+    add_args (args, validate_sound, "--fd", arg_input_fd, NULL);
   g_ptr_array_add (args, NULL);
 
   execvpe (flatpak_get_bwrap (), (char **) args->pdata, NULL);
@@ -311,17 +394,6 @@ rerun_in_sandbox (int input_fd)
 }
 #endif
 
-static gboolean  opt_sandbox;
-static gchar    *opt_path = NULL;
-static gint      opt_fd = -1;
-
-static GOptionEntry entries[] = {
-  { "sandbox", 0, 0, G_OPTION_ARG_NONE, &opt_sandbox, "Run in a sandbox", NULL },
-  { "path", 0, 0, G_OPTION_ARG_FILENAME, &opt_path, "Read sound data from given file path", "PATH" },
-  { "fd", 0, 0, G_OPTION_ARG_INT, &opt_fd, "Read sound data from given file descriptor", "FD" },
-  { NULL }
-};
-
 int
 main (int argc, char *argv[])
 {
@@ -336,6 +408,22 @@ main (int argc, char *argv[])
       return 1;
     }
 
+  if (opt_socket != -1)
+    {
+      if (opt_path != NULL || opt_fd != -1)
+        {
+          g_printerr ("Error: --socket can't be combined with --path or --fd\n");
+          return 1;
+        }
+
+#ifdef HELPER
+      if (opt_sandbox)
+        return rerun_in_sandbox (opt_socket);
+      else
+#endif
+        return run_server (opt_socket);
+    }
+
   if (opt_path != NULL && opt_fd != -1)
     {
       g_printerr ("Error: Only --path or --fd can be given\n");
@@ -0,0 +1,215 @@
+/*
+ * Copyright © 2024 Red Hat, Inc
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <glib/gstdio.h>
+
+#include "glib-backports.h"
+#include "validator-server.h"
+
+/* The validator side of the protocol described in xdp-validator.c */
+
+/* The serial number, a space and the request */
+#define MAX_REQUEST_SIZE (20 + 1 + 64)
+#define MAX_REPLY_SIZE 4096
+
+static ssize_t
+receive_request (int     socket_fd,
+                 char   *request,
+                 size_t  request_size,
+                 int    *out_fd)
+{
+  union {
+    char buf[CMSG_SPACE (sizeof (int))];
+    struct cmsghdr align;
+  } control;
+  struct iovec iov = { request, request_size };
+  struct msghdr msg = { 0 };
+  struct cmsghdr *cmsg;
+  ssize_t res;
+
+  *out_fd = -1;
+
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+  do
+    res = recvmsg (socket_fd, &msg, MSG_CMSG_CLOEXEC);
+  while (res < 0 && errno == EINTR);
+
+  if (res <= 0)
+    return res;
+
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg))
+    {
+      if (cmsg->cmsg_level == SOL_SOCKET &&
+          cmsg->cmsg_type == SCM_RIGHTS &&
+          cmsg->cmsg_len == CMSG_LEN (sizeof (int)))
+        memcpy (out_fd, CMSG_DATA (cmsg), sizeof (int));
+    }
+
+  return res;
+}
+
+/* Validates the file in a child process, so that a malicious file can't
+ * affect the validation of the following ones. The child can't reach
+ * @socket_fd, so it can't send replies of its own. Returns the reply code:
+ * '0' if the file is valid, '1' if it is invalid and '2' if it couldn't
+ * be validated, e.g. because the child crashed.
+ */
+static char
+validate_in_child (ValidatorFunc  validate,
+                   int            socket_fd,
+                   int            input_fd,
+                   const char    *request,
+                   GString       *output)
+{
+  g_autofd int read_fd = -1;
+  g_autofd int write_fd = -1;
+  int pipe_fds[2];
+  char buf[1024];
+  ssize_t res;
+  int status;
+  pid_t pid;
+
+  if (pipe2 (pipe_fds, O_CLOEXEC) < 0)
+    {
+      g_printerr ("%s: Failed to create pipe: %s\n", g_get_prgname (), g_strerror (errno));
+      return '2';
+    }
+
+  read_fd = pipe_fds[0];
+  write_fd = pipe_fds[1];
+
+  pid = fork ();
+  if (pid < 0)
+    {
+      g_printerr ("%s: Failed to fork: %s\n", g_get_prgname (), g_strerror (errno));
+      return '2';
+    }
+
+  if (pid == 0)
+    {
+      int ret;
+
+      close (socket_fd);
+      close (read_fd);
+
+      if (dup2 (write_fd, STDOUT_FILENO) < 0)
+        _exit (VALIDATOR_EXIT_FAILED);
+
+      ret = validate (input_fd, request);
+      fflush (stdout);
+      _exit (ret);
+    }
+
+  g_clear_fd (&write_fd, NULL);
+
+  while (TRUE)
+    {
+      res = read (read_fd, buf, sizeof (buf));
+      if (res < 0 && errno == EINTR)
+        continue;
+      if (res <= 0)
+        break;
+
+      if (output->len + res < MAX_REPLY_SIZE)
+        g_string_append_len (output, buf, res);
+    }
+
+  while (waitpid (pid, &status, 0) < 0)
+    {
+      if (errno != EINTR)
+        return '2';
+    }
+
+  if (!WIFEXITED (status))
+    return '2';
+
+  switch (WEXITSTATUS (status))
+    {
+    case VALIDATOR_EXIT_VALID:
+      return '0';
+    case VALIDATOR_EXIT_INVALID:
+      return '1';
+    default:
+      return '2';
+    }
+}
+
+/* Serves validation requests received on @socket_fd with @validate until
+ * the socket is closed. Anything that only needs to be loaded once should
+ * be loaded before, so that the children inherit it.
+ */
+int
+validator_run_server (int           socket_fd,
+                      ValidatorFunc validate)
+{
+  while (TRUE)
+    {
+      g_autoptr(GString) reply = g_string_new ("2");
+      g_autofd int input_fd = -1;
+      char request[MAX_REQUEST_SIZE + 1];
+      char *payload;
+      ssize_t res;
+
+      res = receive_request (socket_fd, request, MAX_REQUEST_SIZE, &input_fd);
+      if (res == 0)
+        return 0;
+
+      if (res < 0)
+        {
+          g_printerr ("%s: Failed to receive request: %s\n", g_get_prgname (), g_strerror (errno));
+          return 1;
+        }
+
+      request[res] = '\0';
+
+      /* The serial is sent back as is, for the portal to check */
+      payload = strchr (request, ' ');
+      if (payload)
+        *payload++ = '\0';
+      g_string_append_printf (reply, "%s\n", request);
+
+      if (payload == NULL)
+        g_printerr ("%s: No serial in request\n", g_get_prgname ());
+      else if (input_fd == -1)
+        g_printerr ("%s: No file descriptor in request\n", g_get_prgname ());
+      else
+        reply->str[0] = validate_in_child (validate, socket_fd, input_fd, payload, reply);
+
+      do
+        res = send (socket_fd, reply->str, reply->len, MSG_NOSIGNAL);
+      while (res < 0 && errno == EINTR);
+
+      if (res < 0)
+        {
+          g_printerr ("%s: Failed to send reply: %s\n", g_get_prgname (), g_strerror (errno));
+          return 1;
+        }
+    }
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright © 2024 Red Hat, Inc
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+/* The exit status of a validator. Only VALIDATOR_EXIT_INVALID means that
+ * the file itself was found to be bad; anything else that isn't
+ * VALIDATOR_EXIT_VALID means that it couldn't be validated right now.
+ */
+#define VALIDATOR_EXIT_VALID 0
+#define VALIDATOR_EXIT_INVALID 1
+#define VALIDATOR_EXIT_FAILED 2
+
+/* Validates the file in @input_fd as asked by @request, and prints the
+ * result to stdout as a key file. It is called in a child process for
+ * every request, and returns the exit status of that child. */
+typedef int (*ValidatorFunc) (int         input_fd,
+                              const char *request);
+
+int validator_run_server (int           socket_fd,
+                          ValidatorFunc validate);
@@ -132,7 +132,7 @@ handle_set_wallpaper_in_thread_func (GTask *task,
   g_autofree char *uri = NULL;
   g_auto(GVariantBuilder) opt_builder =
     G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
-  g_autoptr(XdpDbusImplRequest) impl_request = NULL;
+  g_autoptr(XdpImplRequest) impl_request = NULL;
   GVariant *options;
   gboolean show_preview = FALSE;
   g_autofd int fd = -1;
@@ -271,19 +271,7 @@ handle_set_wallpaper_in_thread_func (GTask *task,
       g_object_set_data_full (G_OBJECT (request), "uri", g_strdup (uri), g_free);
     }
 
-  impl_request = xdp_dbus_impl_request_proxy_new_sync (g_dbus_proxy_get_connection (G_DBUS_PROXY (impl)),
-                                                       G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
-                                                       g_dbus_proxy_get_name (G_DBUS_PROXY (impl)),
-                                                       request->id,
-                                                       NULL, &error);
-
-  if (!impl_request)
-    {
-      g_warning ("Failed to to create wallpaper implementation proxy: %s", error->message);
-      send_response (request, 2);
-      return;
-    }
-
+  impl_request = xdp_impl_request_new (G_DBUS_PROXY (impl), request->id);
   xdp_request_set_impl_request (request, impl_request);
 
   xdp_filter_options (options, &opt_builder,
@@ -37,6 +37,7 @@
 #include "xdp-impl-dbus.h"
 #include "xdp-method-info.h"
 #include "xdp-portal-impl.h"
+#include "xdp-scheduler.h"
 #include "xdp-session-persistence.h"
 
 #include "account.h"
@@ -168,10 +169,7 @@ export_portal_implementation (GDBusConnection *connection,
       return;
     }
 
-  g_dbus_interface_skeleton_set_flags (skeleton,
-                                       G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD);
-  g_signal_connect (skeleton, "g-authorize-method",
-                    G_CALLBACK (authorize_callback), NULL);
+  xdp_scheduler_handle_skeleton (skeleton, authorize_callback, NULL);
 
   if (!g_dbus_interface_skeleton_export (skeleton,
                                          connection,
@@ -186,11 +184,28 @@ export_portal_implementation (GDBusConnection *connection,
 }
 
 static void
-peer_died_cb (const char *name)
+cleanup_peer_in_thread_func (GTask        *task,
+                             gpointer      source_object,
+                             gpointer      task_data,
+                             GCancellable *cancellable)
 {
+  const char *name = (const char *) task_data;
+
   close_requests_for_sender (name);
   close_sessions_for_sender (name);
   xdp_session_persistence_delete_transient_permissions_for_sender (name);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+peer_died_cb (const char *name)
+{
+  g_autoptr(GTask) task = NULL;
+
+  task = g_task_new (NULL, NULL, NULL, NULL);
+  g_task_set_task_data (task, g_strdup (name), g_free);
+  g_task_run_in_thread (task, cleanup_peer_in_thread_func);
 }
 
 static void
@@ -217,6 +232,7 @@ on_bus_acquired (GDBusConnection *connection,
   portal_errors = XDG_DESKTOP_PORTAL_ERROR;
 
   xdp_connection_track_name_owners (connection, peer_died_cb);
+  xdp_connection_prefetch_app_infos (connection);
 
   if (!xdp_init_permission_store (connection, &error))
     {
@@ -58,6 +58,38 @@ struct _XdpAppInfoFlatpak
 
 G_DEFINE_FINAL_TYPE (XdpAppInfoFlatpak, xdp_app_info_flatpak, XDP_TYPE_APP_INFO)
 
+/* Identity of the .flatpak-info file of an instance */
+typedef struct
+{
+  dev_t dev;
+  ino_t ino;
+} FlatpakInfoId;
+
+/* Parsed metadata of a running flatpak instance, shared by all the
+ * connections made from inside that instance. */
+typedef struct
+{
+  FlatpakInfoId info_id;
+
+  char *instance;
+  ino_t instance_dir_ino;
+
+  GKeyFile *metadata;
+  char *id;
+  GAppInfo *gappinfo;
+  gboolean has_network;
+  int bwrap_pidfd;
+} FlatpakInstanceData;
+
+/* Instances that went away are only noticed when looked up, so the table
+ * is swept whenever it has doubled in size since the last sweep */
+#define MIN_INSTANCES_SWEEP_SIZE 16
+
+G_LOCK_DEFINE_STATIC (instances);
+/* FlatpakInfoId => FlatpakInstanceData */
+static GHashTable *instances;
+static guint instances_sweep_size = MIN_INSTANCES_SWEEP_SIZE;
+
 static gboolean
 is_valid_initial_name_character (gint c, gboolean allow_dash)
 {
@@ -487,7 +519,7 @@ xdp_app_info_flatpak_dispose (GObject *object)
 {
   XdpAppInfoFlatpak *app_info = XDP_APP_INFO_FLATPAK (object);
 
-  g_clear_pointer (&app_info->flatpak_info, g_key_file_free);
+  g_clear_pointer (&app_info->flatpak_info, g_key_file_unref);
   g_clear_pointer (&app_info->queries, g_ptr_array_unref);
 
   G_OBJECT_CLASS (xdp_app_info_flatpak_parent_class)->dispose (object);
@@ -637,12 +669,143 @@ get_bwrap_pidfd (const char  *instance,
   return g_steal_fd (&fd);
 }
 
+static void
+flatpak_instance_data_free (FlatpakInstanceData *data)
+{
+  g_clear_pointer (&data->instance, g_free);
+  g_clear_pointer (&data->metadata, g_key_file_unref);
+  g_clear_pointer (&data->id, g_free);
+  g_clear_object (&data->gappinfo);
+  g_clear_fd (&data->bwrap_pidfd, NULL);
+  g_free (data);
+}
+
+static gboolean
+get_instance_dir_ino (const char *instance,
+                      ino_t      *ino_out)
+{
+  g_autofree char *path = NULL;
+  struct stat st_buf;
+
+  path = g_build_filename (g_get_user_runtime_dir (), ".flatpak", instance, NULL);
+  if (stat (path, &st_buf) != 0 || !S_ISDIR (st_buf.st_mode))
+    return FALSE;
+
+  *ino_out = st_buf.st_ino;
+  return TRUE;
+}
+
+/* An instance is still the same if its instance directory was not
+ * replaced, and its bwrap process is still alive. */
+static gboolean
+flatpak_instance_data_is_valid (FlatpakInstanceData *data)
+{
+  ino_t instance_dir_ino;
+  ino_t pidns;
+
+  if (!get_instance_dir_ino (data->instance, &instance_dir_ino) ||
+      instance_dir_ino != data->instance_dir_ino)
+    return FALSE;
+
+  return xdp_pidfd_get_namespace (data->bwrap_pidfd, &pidns, NULL);
+}
+
+static XdpAppInfo *
+app_info_flatpak_new_from_data (FlatpakInstanceData *data)
+{
+  g_autoptr (XdpAppInfoFlatpak) app_info_flatpak = NULL;
+
+  app_info_flatpak = g_object_new (XDP_TYPE_APP_INFO_FLATPAK, NULL);
+  xdp_app_info_initialize (XDP_APP_INFO (app_info_flatpak),
+                           FLATPAK_ENGINE_ID, data->id, data->instance,
+                           data->bwrap_pidfd, data->gappinfo,
+                           TRUE, data->has_network, TRUE);
+  app_info_flatpak->flatpak_info = g_key_file_ref (data->metadata);
+
+  return XDP_APP_INFO (g_steal_pointer (&app_info_flatpak));
+}
+
+static guint
+flatpak_info_id_hash (gconstpointer key)
+{
+  const FlatpakInfoId *id = key;
+  guint64 ino = id->ino;
+  guint64 dev = id->dev;
+
+  return (guint) (ino ^ (ino >> 32) ^ (dev * 31) ^ (dev >> 32));
+}
+
+static gboolean
+flatpak_info_id_equal (gconstpointer a,
+                       gconstpointer b)
+{
+  const FlatpakInfoId *id_a = a;
+  const FlatpakInfoId *id_b = b;
+
+  return id_a->dev == id_b->dev && id_a->ino == id_b->ino;
+}
+
+static XdpAppInfo *
+lookup_cached_instance (const struct stat *info_st_buf)
+{
+  FlatpakInfoId info_id = { info_st_buf->st_dev, info_st_buf->st_ino };
+  FlatpakInstanceData *data;
+  XdpAppInfo *app_info = NULL;
+
+  G_LOCK (instances);
+
+  data = instances ? g_hash_table_lookup (instances, &info_id) : NULL;
+  if (data)
+    {
+      if (flatpak_instance_data_is_valid (data))
+        app_info = app_info_flatpak_new_from_data (data);
+      else
+        g_hash_table_remove (instances, &info_id);
+    }
+
+  G_UNLOCK (instances);
+
+  return app_info;
+}
+
+static void
+cache_instance (FlatpakInstanceData *data)
+{
+  G_LOCK (instances);
+
+  if (instances == NULL)
+    instances = g_hash_table_new_full (flatpak_info_id_hash, flatpak_info_id_equal,
+                                       NULL, (GDestroyNotify) flatpak_instance_data_free);
+
+  /* Forget about instances that went away in the meantime */
+  if (g_hash_table_size (instances) >= instances_sweep_size)
+    {
+      GHashTableIter iter;
+      FlatpakInstanceData *other;
+
+      g_hash_table_iter_init (&iter, instances);
+      while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &other))
+        {
+          if (!flatpak_instance_data_is_valid (other))
+            g_hash_table_iter_remove (&iter);
+        }
+
+      instances_sweep_size = MAX (MIN_INSTANCES_SWEEP_SIZE,
+                                  2 * g_hash_table_size (instances));
+    }
+
+  g_hash_table_replace (instances, &data->info_id, data);
+
+  G_UNLOCK (instances);
+}
+
 XdpAppInfo *
 xdp_app_info_flatpak_new (int      pid,
                           int      pidfd,
                           GError **error)
 {
-  g_autoptr (XdpAppInfoFlatpak) app_info_flatpak = NULL;
+  XdpAppInfo *app_info;
+  FlatpakInstanceData *data;
   g_autofree char *root_path = NULL;
   g_autofd int root_fd = -1;
   g_autofd int info_fd = -1;
@@ -716,6 +879,11 @@ xdp_app_info_flatpak_new (int      pid,
       return NULL;
     }
 
+  /* Other connections from the same instance share the same file */
+  app_info = lookup_cached_instance (&stat_buf);
+  if (app_info)
+    return app_info;
+
   mapped = g_mapped_file_new_from_fd  (info_fd, FALSE, &local_error);
   if (mapped == NULL)
     {
@@ -779,12 +947,22 @@ xdp_app_info_flatpak_new (int      pid,
 
   /* TODO: we can use pidfd to make sure we didn't race for sure */
 
-  app_info_flatpak = g_object_new (XDP_TYPE_APP_INFO_FLATPAK, NULL);
-  xdp_app_info_initialize (XDP_APP_INFO (app_info_flatpak),
-                           FLATPAK_ENGINE_ID, id, instance,
-                           bwrap_pidfd, gappinfo,
-                           TRUE, has_network, TRUE);
-  app_info_flatpak->flatpak_info = g_steal_pointer (&metadata);
+  data = g_new0 (FlatpakInstanceData, 1);
+  data->info_id.dev = stat_buf.st_dev;
+  data->info_id.ino = stat_buf.st_ino;
+  data->instance = g_steal_pointer (&instance);
+  data->metadata = g_steal_pointer (&metadata);
+  data->id = g_steal_pointer (&id);
+  data->gappinfo = g_steal_pointer (&gappinfo);
+  data->has_network = has_network;
+  data->bwrap_pidfd = g_steal_fd (&bwrap_pidfd);
 
-  return XDP_APP_INFO (g_steal_pointer (&app_info_flatpak));
+  app_info = app_info_flatpak_new_from_data (data);
+
+  if (get_instance_dir_ino (data->instance, &data->instance_dir_ino))
+    cache_instance (data);
+  else
+    flatpak_instance_data_free (data);
+
+  return app_info;
 }
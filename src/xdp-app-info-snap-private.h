@@ -39,3 +39,6 @@ XdpAppInfo * xdp_app_info_snap_new (int      pid,
 XDP_EXPORT_TEST
 int _xdp_app_info_snap_parse_cgroup_file (FILE     *f,
                                           gboolean *is_snap);
+
+XDP_EXPORT_TEST
+char * _xdp_app_info_snap_parse_apparmor_label (const char *label);
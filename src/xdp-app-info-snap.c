@@ -32,6 +32,10 @@
 #define SNAP_METADATA_KEY_DESKTOP_FILE "DesktopFile"
 #define SNAP_METADATA_KEY_NETWORK "HasNetworkStatus"
 
+/* How long a cached portal-info result is trusted, even if the snap
+ * revision didn't change, as interface connections can still change */
+#define SNAP_INFO_CACHE_TTL_USEC (60 * G_USEC_PER_SEC)
+
 struct _XdpAppInfoSnap
 {
   XdpAppInfo parent;
@@ -39,6 +43,21 @@ struct _XdpAppInfoSnap
 
 G_DEFINE_FINAL_TYPE (XdpAppInfoSnap, xdp_app_info_snap, XDP_TYPE_APP_INFO)
 
+/* Result of `snap routine portal-info` for a snap instance */
+typedef struct
+{
+  char *revision;
+  gint64 timestamp;
+
+  char *snap_id;
+  GAppInfo *gappinfo;
+  gboolean has_network;
+} SnapInfo;
+
+G_LOCK_DEFINE_STATIC (snap_infos);
+/* snap instance name => SnapInfo */
+static GHashTable *snap_infos;
+
 static void
 xdp_app_info_snap_class_init (XdpAppInfoSnapClass *klass)
 {
@@ -49,6 +68,51 @@ xdp_app_info_snap_init (XdpAppInfoSnap *app_info_snap)
 {
 }
 
+/* Extracts the snap instance name from the AppArmor label snap-confine
+ * puts a snap in, "snap.<instance>.<app> (enforce)" or
+ * "snap.<instance>.hook.<hook> (enforce)". Unlike the cgroup, the label can't
+ * be picked by the process itself, as long as the profile is enforced. */
+char *
+_xdp_app_info_snap_parse_apparmor_label (const char *label)
+{
+  const char *start;
+  const char *end;
+  const char *mode;
+
+  if (!g_str_has_prefix (label, "snap."))
+    return NULL;
+
+  mode = strchr (label, ' ');
+  if (mode == NULL || strcmp (mode, " (enforce)") != 0)
+    return NULL;
+
+  start = label + strlen ("snap.");
+  end = start + strcspn (start, ". ");
+  if (end == start || *end != '.' || end + 1 == mode)
+    return NULL;
+
+  return g_strndup (start, end - start);
+}
+
+static char *
+snap_name_from_apparmor_label (pid_t pid)
+{
+  static const char * const label_files[] = { "attr/apparmor/current", "attr/current" };
+  size_t i;
+
+  for (i = 0; i < G_N_ELEMENTS (label_files); i++)
+    {
+      g_autofree char *path = NULL;
+      g_autofree char *label = NULL;
+
+      path = g_strdup_printf ("/proc/%u/%s", (guint) pid, label_files[i]);
+      if (g_file_get_contents (path, &label, NULL, NULL))
+        return _xdp_app_info_snap_parse_apparmor_label (g_strchomp (label));
+    }
+
+  return NULL;
+}
+
 int
 _xdp_app_info_snap_parse_cgroup_file (FILE     *f,
                                       gboolean *is_snap)
@@ -135,13 +199,105 @@ end:
   return is_snap;
 }
 
+static void
+snap_info_free (SnapInfo *info)
+{
+  g_clear_pointer (&info->revision, g_free);
+  g_clear_pointer (&info->snap_id, g_free);
+  g_clear_object (&info->gappinfo);
+  g_free (info);
+}
+
+/* The "current" symlink of a snap points at the active revision */
+static char *
+get_snap_revision (const char *snap_name)
+{
+  static const char * const snap_mount_dirs[] = { "/snap", "/var/lib/snapd/snap" };
+  size_t i;
+
+  for (i = 0; i < G_N_ELEMENTS (snap_mount_dirs); i++)
+    {
+      g_autofree char *path = NULL;
+      char *revision;
+
+      path = g_build_filename (snap_mount_dirs[i], snap_name, "current", NULL);
+      revision = g_file_read_link (path, NULL);
+      if (revision)
+        return revision;
+    }
+
+  return NULL;
+}
+
+static XdpAppInfo *
+app_info_snap_new_from_info (SnapInfo *info,
+                             int       pidfd)
+{
+  g_autoptr (XdpAppInfoSnap) app_info_snap = NULL;
+
+  app_info_snap = g_object_new (XDP_TYPE_APP_INFO_SNAP, NULL);
+  xdp_app_info_initialize (XDP_APP_INFO (app_info_snap),
+                           "io.snapcraft", info->snap_id, NULL,
+                           pidfd, info->gappinfo,
+                           FALSE, info->has_network, TRUE);
+
+  return XDP_APP_INFO (g_steal_pointer (&app_info_snap));
+}
+
+static XdpAppInfo *
+lookup_cached_snap_info (const char *snap_name,
+                         const char *revision,
+                         int         pidfd)
+{
+  SnapInfo *info;
+  XdpAppInfo *app_info = NULL;
+
+  G_LOCK (snap_infos);
+
+  if (snap_infos)
+    {
+      info = g_hash_table_lookup (snap_infos, snap_name);
+      if (info &&
+          (strcmp (info->revision, revision) != 0 ||
+           g_get_monotonic_time () - info->timestamp > SNAP_INFO_CACHE_TTL_USEC))
+        {
+          g_hash_table_remove (snap_infos, snap_name);
+          info = NULL;
+        }
+
+      if (info)
+        app_info = app_info_snap_new_from_info (info, pidfd);
+    }
+
+  G_UNLOCK (snap_infos);
+
+  return app_info;
+}
+
+static void
+cache_snap_info (const char *snap_name,
+                 SnapInfo   *info)
+{
+  G_LOCK (snap_infos);
+
+  if (snap_infos == NULL)
+    snap_infos = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                        (GDestroyNotify) snap_info_free);
+
+  g_hash_table_replace (snap_infos, g_strdup (snap_name), info);
+
+  G_UNLOCK (snap_infos);
+}
+
 XdpAppInfo *
 xdp_app_info_snap_new (int      pid,
                        int      pidfd,
                        GError **error)
 {
-  g_autoptr (XdpAppInfoSnap) app_info_snap = NULL;
-
+  XdpAppInfo *app_info;
+  SnapInfo *info;
+  g_autofree char *label_snap_name = NULL;
+  g_autofree char *revision = NULL;
   g_autoptr(GError) local_error = NULL;
   g_autofree char *pid_str = NULL;
   g_autofree char *output = NULL;
@@ -160,6 +316,20 @@ xdp_app_info_snap_new (int      pid,
       return NULL;
     }
 
+  /* Avoid asking snapd again for further connections of the same snap.
+   * Only confined snaps have a label to key the results on; the others
+   * always go through snapd. */
+  label_snap_name = snap_name_from_apparmor_label (pid);
+  if (label_snap_name)
+    revision = get_snap_revision (label_snap_name);
+
+  if (revision)
+    {
+      app_info = lookup_cached_snap_info (label_snap_name, revision, pidfd);
+      if (app_info)
+        return app_info;
+    }
+
   pid_str = g_strdup_printf ("%u", (guint) pid);
   output = xdp_spawn (error, "snap", "routine", "portal-info", pid_str, NULL);
   if (output == NULL)
@@ -196,11 +366,23 @@ xdp_app_info_snap_new (int      pid,
                                         SNAP_METADATA_KEY_NETWORK,
                                         NULL);
 
-  app_info_snap = g_object_new (XDP_TYPE_APP_INFO_SNAP, NULL);
-  xdp_app_info_initialize (XDP_APP_INFO (app_info_snap),
-                           "io.snapcraft", snap_id, NULL,
-                           pidfd, gappinfo,
-                           FALSE, has_network, TRUE);
+  info = g_new0 (SnapInfo, 1);
+  info->timestamp = g_get_monotonic_time ();
+  info->snap_id = g_steal_pointer (&snap_id);
+  info->gappinfo = g_steal_pointer (&gappinfo);
+  info->has_network = has_network;
 
-  return XDP_APP_INFO (g_steal_pointer (&app_info_snap));
+  app_info = app_info_snap_new_from_info (info, pidfd);
+
+  if (revision && g_strcmp0 (label_snap_name, snap_name) == 0)
+    {
+      info->revision = g_steal_pointer (&revision);
+      cache_snap_info (label_snap_name, info);
+    }
+  else
+    {
+      snap_info_free (info);
+    }
+
+  return app_info;
 }
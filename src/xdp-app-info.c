@@ -55,6 +55,11 @@
 
 G_LOCK_DEFINE (app_infos);
 static GHashTable *app_info_by_unique_name;
+/* Unique names which are being resolved in the background. Waiters block
+ * on app_infos_cond until the name is removed from this set. */
+static GHashTable *app_info_pending;
+static GCond app_infos_cond;
+static GThreadPool *app_info_prefetch_pool;
 
 G_DEFINE_QUARK (XdpAppInfo, xdp_app_info_error);
 
@@ -72,6 +77,8 @@ typedef struct _XdpAppInfoPrivate
   /* pid namespace mapping */
   GMutex pidns_lock;
   ino_t pidns_id;
+
+  XdpUsbMatcher *usb_matcher;
 } XdpAppInfoPrivate;
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (XdpAppInfo, xdp_app_info, G_TYPE_OBJECT)
@@ -87,6 +94,7 @@ xdp_app_info_dispose (GObject *object)
   g_clear_pointer (&priv->id, g_free);
   g_clear_pointer (&priv->instance, g_free);
   g_clear_object (&priv->gappinfo);
+  g_clear_pointer (&priv->usb_matcher, xdp_usb_matcher_free);
 
   if (!g_clear_fd (&priv->pidfd, &error))
     g_warning ("Error closing pidfd: %s", error->message);
@@ -566,6 +574,24 @@ xdp_app_info_get_usb_queries (XdpAppInfo *app_info)
   return XDP_APP_INFO_GET_CLASS (app_info)->get_usb_queries (app_info);
 }
 
+/* The USB queries of the app, compiled once for matching devices against
+ * them quickly */
+const XdpUsbMatcher *
+xdp_app_info_get_usb_matcher (XdpAppInfo *app_info)
+{
+  XdpAppInfoPrivate *priv = xdp_app_info_get_instance_private (app_info);
+
+  if (g_once_init_enter (&priv->usb_matcher))
+    {
+      XdpUsbMatcher *matcher;
+
+      matcher = xdp_usb_matcher_new (xdp_app_info_get_usb_queries (app_info));
+      g_once_init_leave (&priv->usb_matcher, matcher);
+    }
+
+  return priv->usb_matcher;
+}
+
 static gboolean
 xdp_connection_get_pid_legacy (GDBusConnection  *connection,
                                const char       *sender,
@@ -695,19 +721,18 @@ xdp_connection_get_pidfd (GDBusConnection  *connection,
   return TRUE;
 }
 
+/* Must be called with the app_infos lock held */
 static XdpAppInfo *
-cache_lookup_app_info_by_sender (const char *sender)
+cache_lookup_app_info_by_sender_locked (const char *sender)
 {
   XdpAppInfo *app_info = NULL;
 
-  G_LOCK (app_infos);
   if (app_info_by_unique_name)
     {
       app_info = g_hash_table_lookup (app_info_by_unique_name, sender);
       if (app_info)
         g_object_ref (app_info);
     }
-  G_UNLOCK (app_infos);
 
   return app_info;
 }
@@ -738,14 +763,30 @@ on_peer_died (const char *name)
   G_LOCK (app_infos);
   if (app_info_by_unique_name)
     g_hash_table_remove (app_info_by_unique_name, name);
+  /* Make a pending background resolution drop its result, and let
+   * anyone waiting for it try on their own */
+  if (app_info_pending && g_hash_table_remove (app_info_pending, name))
+    g_cond_broadcast (&app_infos_cond);
   G_UNLOCK (app_infos);
 }
 
+static void
+ensure_peer_tracking (GDBusConnection *connection)
+{
+  static gsize tracking = 0;
+
+  if (g_once_init_enter (&tracking))
+    {
+      xdp_connection_track_name_owners (connection, on_peer_died);
+      g_once_init_leave (&tracking, 1);
+    }
+}
+
 static XdpAppInfo *
-xdp_connection_lookup_app_info_sync (GDBusConnection  *connection,
-                                     const char       *sender,
-                                     GCancellable     *cancellable,
-                                     GError          **error)
+resolve_app_info_sync (GDBusConnection  *connection,
+                       const char       *sender,
+                       GCancellable     *cancellable,
+                       GError          **error)
 {
   g_autoptr(XdpAppInfo) app_info = NULL;
   g_autofd int pidfd = -1;
@@ -754,10 +795,6 @@ xdp_connection_lookup_app_info_sync (GDBusConnection  *connection,
   const char *test_override_usb_queries;
   g_autoptr(GError) local_error = NULL;
 
-  app_info = cache_lookup_app_info_by_sender (sender);
-  if (app_info)
-    return g_steal_pointer (&app_info);
-
   if (!xdp_connection_get_pidfd (connection, sender, cancellable, &pidfd, &pid, error))
     return NULL;
 
@@ -796,13 +833,140 @@ xdp_connection_lookup_app_info_sync (GDBusConnection  *connection,
 
   g_return_val_if_fail (app_info != NULL, NULL);
 
+  return g_steal_pointer (&app_info);
+}
+
+static XdpAppInfo *
+xdp_connection_lookup_app_info_sync (GDBusConnection  *connection,
+                                     const char       *sender,
+                                     GCancellable     *cancellable,
+                                     GError          **error)
+{
+  g_autoptr(XdpAppInfo) app_info = NULL;
+
+  G_LOCK (app_infos);
+  while (TRUE)
+    {
+      app_info = cache_lookup_app_info_by_sender_locked (sender);
+      if (app_info ||
+          !app_info_pending ||
+          !g_hash_table_contains (app_info_pending, sender))
+        break;
+
+      /* Already being resolved in the background, wait for the result */
+      g_cond_wait (&app_infos_cond, &G_LOCK_NAME (app_infos));
+    }
+  G_UNLOCK (app_infos);
+
+  if (app_info)
+    return g_steal_pointer (&app_info);
+
+  app_info = resolve_app_info_sync (connection, sender, cancellable, error);
+  if (!app_info)
+    return NULL;
+
   cache_insert_app_info (sender, app_info);
 
-  xdp_connection_track_name_owners (connection, on_peer_died);
+  ensure_peer_tracking (connection);
 
   return g_steal_pointer (&app_info);
 }
 
+static void
+prefetch_app_info_func (gpointer data,
+                        gpointer user_data)
+{
+  g_autofree char *sender = data;
+  GDBusConnection *connection = user_data;
+  g_autoptr(XdpAppInfo) app_info = NULL;
+  g_autoptr(GError) error = NULL;
+
+  app_info = resolve_app_info_sync (connection, sender, NULL, &error);
+  if (!app_info)
+    g_debug ("Failed to prefetch app info for %s: %s", sender, error->message);
+
+  G_LOCK (app_infos);
+  /* If the peer died in the meantime, it is no longer pending */
+  if (g_hash_table_remove (app_info_pending, sender))
+    {
+      if (app_info)
+        {
+          ensure_app_info_by_unique_name ();
+          g_hash_table_insert (app_info_by_unique_name, g_strdup (sender),
+                               g_object_ref (app_info));
+        }
+      g_cond_broadcast (&app_infos_cond);
+    }
+  G_UNLOCK (app_infos);
+}
+
+#define MAX_PREFETCH_THREADS 2
+#define MAX_QUEUED_PREFETCHES 16
+
+static void
+name_appeared (GDBusConnection *connection,
+               const gchar     *sender_name,
+               const gchar     *object_path,
+               const gchar     *interface_name,
+               const gchar     *signal_name,
+               GVariant        *parameters,
+               gpointer         user_data)
+{
+  const char *name, *from, *to;
+
+  g_variant_get (parameters, "(&s&s&s)", &name, &from, &to);
+
+  if (name[0] != ':' ||
+      strcmp (from, "") != 0 ||
+      strcmp (name, to) != 0)
+    return;
+
+  /* Every peer on the bus shows up here, not only portal callers, so
+   * names that arrive while the queue is full are left to be resolved on
+   * their first call */
+  if (g_thread_pool_unprocessed (app_info_prefetch_pool) >= MAX_QUEUED_PREFETCHES)
+    return;
+
+  G_LOCK (app_infos);
+  if (!g_hash_table_contains (app_info_pending, name) &&
+      !(app_info_by_unique_name &&
+        g_hash_table_contains (app_info_by_unique_name, name)))
+    {
+      g_hash_table_add (app_info_pending, g_strdup (name));
+      g_thread_pool_push (app_info_prefetch_pool, g_strdup (name), NULL);
+    }
+  G_UNLOCK (app_infos);
+}
+
+/* Resolves the app info of new peers on @connection in the background, as
+ * soon as they connect to the bus, so that their first portal call finds
+ * it in the cache.
+ */
+void
+xdp_connection_prefetch_app_infos (GDBusConnection *connection)
+{
+  g_return_if_fail (app_info_prefetch_pool == NULL);
+
+  ensure_peer_tracking (connection);
+
+  app_info_pending = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                            g_free, NULL);
+  app_info_prefetch_pool = g_thread_pool_new (prefetch_app_info_func,
+                                              g_object_ref (connection),
+                                              MAX_PREFETCH_THREADS,
+                                              FALSE, NULL);
+
+  g_dbus_connection_signal_subscribe (connection,
+                                      DBUS_NAME_DBUS,
+                                      DBUS_INTERFACE_DBUS,
+                                      "NameOwnerChanged",
+                                      DBUS_PATH_DBUS,
+                                      NULL,
+                                      G_DBUS_SIGNAL_FLAGS_NONE,
+                                      name_appeared,
+                                      NULL, NULL);
+}
+
 XdpAppInfo *
 xdp_invocation_lookup_app_info_sync (GDBusMethodInvocation  *invocation,
                                      GCancellable           *cancellable,
@@ -30,6 +30,7 @@
 #include <gio/gdesktopappinfo.h>
 
 #include "glib-backports.h"
+#include "xdp-usb-query.h"
 
 typedef enum _XdpAppInfoError
 {
@@ -81,6 +82,10 @@ gboolean xdp_app_info_validate_dynamic_launcher (XdpAppInfo  *app_info,
 
 const GPtrArray * xdp_app_info_get_usb_queries (XdpAppInfo *app_info);
 
+const XdpUsbMatcher * xdp_app_info_get_usb_matcher (XdpAppInfo *app_info);
+
+void xdp_connection_prefetch_app_infos (GDBusConnection *connection);
+
 XdpAppInfo * xdp_invocation_lookup_app_info_sync (GDBusMethodInvocation  *invocation,
                                                   GCancellable           *cancellable,
                                                   GError                **error);
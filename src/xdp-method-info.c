@@ -20,30 +20,47 @@
 
 #include "config.h"
 
+#include <stdlib.h>
+#include <string.h>
 #include <glib.h>
 
 #include "xdp-method-info.h"
 
+static int
+compare_interface (const void *key,
+                   const void *element)
+{
+  const XdpMethodInterfaceInfo *ii = element;
+
+  return strcmp (key, ii->interface);
+}
+
+static int
+compare_method (const void *key,
+                const void *element)
+{
+  const XdpMethodInfo *mi = element;
+
+  return strcmp (key, mi->method);
+}
+
 const XdpMethodInfo *
 xdp_method_info_find (const char *interface,
                       const char *method)
 {
-  const XdpMethodInfo *mi = NULL;
-  gboolean interface_found = FALSE;
-
-  mi = xdp_method_info_get_all ();
-  while (mi->interface != NULL)
-    {
-      if (strcmp (interface, mi->interface) == 0)
-        {
-          interface_found = TRUE;
-          if (strcmp (method, mi->method) == 0)
-            return mi;
-        }
-      else if (interface_found)
-        break;
-      mi++;
-    }
-
-  return NULL;
+  const XdpMethodInterfaceInfo *ii;
+
+  ii = bsearch (interface,
+                xdp_method_info_get_interfaces (),
+                xdp_method_info_get_n_interfaces (),
+                sizeof (XdpMethodInterfaceInfo),
+                compare_interface);
+  if (ii == NULL)
+    return NULL;
+
+  return bsearch (method,
+                  xdp_method_info_get_all () + ii->first,
+                  ii->n_methods,
+                  sizeof (XdpMethodInfo),
+                  compare_method);
 }
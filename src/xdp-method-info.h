@@ -29,6 +29,14 @@ typedef struct {
   int option_arg;
 } XdpMethodInfo;
 
+/* The generated method info table is sorted by interface, then by method,
+ * and each interface refers to its range of methods in that table. */
+typedef struct {
+  const char *interface;
+  unsigned int first;
+  unsigned int n_methods;
+} XdpMethodInterfaceInfo;
+
 const XdpMethodInfo *
 xdp_method_info_find (const char *interface,
                       const char *method);
@@ -38,3 +46,9 @@ xdp_method_info_get_all (void);
 
 unsigned int
 xdp_method_info_get_count (void);
+
+const XdpMethodInterfaceInfo *
+xdp_method_info_get_interfaces (void);
+
+unsigned int
+xdp_method_info_get_n_interfaces (void);
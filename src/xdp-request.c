@@ -24,9 +24,75 @@
 #include "xdp-request.h"
 #include "xdp-utils.h"
 #include "xdp-method-info.h"
+#include "xdp-scheduler.h"
 
 #include <string.h>
 
+struct _XdpImplRequest
+{
+  gatomicrefcount ref_count;
+
+  GDBusConnection *connection;
+  char *bus_name;
+  char *object_path;
+};
+
+XdpImplRequest *
+xdp_impl_request_new (GDBusProxy *impl,
+                      const char *object_path)
+{
+  XdpImplRequest *impl_request;
+
+  impl_request = g_new0 (XdpImplRequest, 1);
+  g_atomic_ref_count_init (&impl_request->ref_count);
+  impl_request->connection = g_object_ref (g_dbus_proxy_get_connection (impl));
+  impl_request->bus_name = g_strdup (g_dbus_proxy_get_name (impl));
+  impl_request->object_path = g_strdup (object_path);
+
+  return impl_request;
+}
+
+XdpImplRequest *
+xdp_impl_request_ref (XdpImplRequest *impl_request)
+{
+  g_atomic_ref_count_inc (&impl_request->ref_count);
+  return impl_request;
+}
+
+void
+xdp_impl_request_unref (XdpImplRequest *impl_request)
+{
+  if (!g_atomic_ref_count_dec (&impl_request->ref_count))
+    return;
+
+  g_clear_object (&impl_request->connection);
+  g_clear_pointer (&impl_request->bus_name, g_free);
+  g_clear_pointer (&impl_request->object_path, g_free);
+  g_free (impl_request);
+}
+
+gboolean
+xdp_impl_request_close_sync (XdpImplRequest  *impl_request,
+                             GCancellable    *cancellable,
+                             GError         **error)
+{
+  g_autoptr(GVariant) ret = NULL;
+
+  ret = g_dbus_connection_call_sync (impl_request->connection,
+                                     impl_request->bus_name,
+                                     impl_request->object_path,
+                                     "org.freedesktop.impl.portal.Request",
+                                     "Close",
+                                     NULL,
+                                     G_VARIANT_TYPE_UNIT,
+                                     G_DBUS_CALL_FLAGS_NONE,
+                                     -1,
+                                     cancellable,
+                                     error);
+
+  return ret != NULL;
+}
+
 static void xdp_request_skeleton_iface_init (XdpDbusRequestIface *iface);
 
 G_DEFINE_TYPE_WITH_CODE (XdpRequest, xdp_request, XDP_DBUS_TYPE_REQUEST_SKELETON,
@@ -76,8 +142,8 @@ xd_request_handle_close (XdpDbusRequest        *object,
   if (request->exported)
     {
       if (request->impl_request &&
-          !xdp_dbus_impl_request_call_close_sync (request->impl_request,
-                                                  NULL, &error))
+          !xdp_impl_request_close_sync (request->impl_request,
+                                        NULL, &error))
         {
           if (invocation)
             g_dbus_method_invocation_return_gerror (invocation, error);
@@ -102,6 +168,8 @@ xdp_request_skeleton_iface_init (XdpDbusRequestIface *iface)
 
 G_LOCK_DEFINE (requests);
 static GHashTable *requests;
+/* sender => set of XdpRequest, protected by the requests lock */
+static GHashTable *requests_by_sender;
 
 static void
 xdp_request_init (XdpRequest *request)
@@ -116,9 +184,19 @@ xdp_request_finalize (GObject *object)
 
   G_LOCK (requests);
   g_hash_table_remove (requests, request->id);
+  if (request->sender)
+    {
+      GHashTable *sender_requests;
+
+      sender_requests = g_hash_table_lookup (requests_by_sender, request->sender);
+      if (sender_requests &&
+          g_hash_table_remove (sender_requests, request) &&
+          g_hash_table_size (sender_requests) == 0)
+        g_hash_table_remove (requests_by_sender, request->sender);
+    }
   G_UNLOCK (requests);
 
-  g_clear_object (&request->impl_request);
+  g_clear_pointer (&request->impl_request, xdp_impl_request_unref);
   g_clear_pointer (&request->sender, g_free);
   g_clear_pointer (&request->id, g_free);
   g_mutex_clear (&request->mutex);
@@ -134,6 +212,8 @@ xdp_request_class_init (XdpRequestClass *klass)
 
   requests = g_hash_table_new_full (g_str_hash, g_str_equal,
                                     NULL, NULL);
+  requests_by_sender = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                              g_free, (GDestroyNotify) g_hash_table_unref);
 
   gobject_class = G_OBJECT_CLASS (klass);
   gobject_class->finalize  = xdp_request_finalize;
@@ -205,6 +285,7 @@ xdp_request_init_invocation (GDBusMethodInvocation *invocation,
                              XdpAppInfo            *app_info)
 {
   XdpRequest *request;
+  GHashTable *sender_requests;
   guint32 r;
   char *id = NULL;
   const char *token;
@@ -237,13 +318,19 @@ xdp_request_init_invocation (GDBusMethodInvocation *invocation,
   request->id = id;
   g_hash_table_insert (requests, id, request);
 
+  sender_requests = g_hash_table_lookup (requests_by_sender, request->sender);
+  if (sender_requests == NULL)
+    {
+      sender_requests = g_hash_table_new (NULL, NULL);
+      g_hash_table_insert (requests_by_sender, g_strdup (request->sender), sender_requests);
+    }
+  g_hash_table_add (sender_requests, request);
+
   G_UNLOCK (requests);
 
-  g_dbus_interface_skeleton_set_flags (G_DBUS_INTERFACE_SKELETON (request),
-                                       G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD);
-  g_signal_connect (request, "g-authorize-method",
-                    G_CALLBACK (request_authorize_callback),
-                    request->sender);
+  xdp_scheduler_handle_skeleton (G_DBUS_INTERFACE_SKELETON (request),
+                                 request_authorize_callback,
+                                 request->sender);
 
 
   g_object_set_data_full (G_OBJECT (invocation), "request", request, g_object_unref);
@@ -295,33 +382,35 @@ xdp_request_unexport (XdpRequest *request)
 }
 
 void
-xdp_request_set_impl_request (XdpRequest         *request,
-                              XdpDbusImplRequest *impl_request)
+xdp_request_set_impl_request (XdpRequest     *request,
+                              XdpImplRequest *impl_request)
 {
-  g_set_object (&request->impl_request, impl_request);
+  if (impl_request)
+    xdp_impl_request_ref (impl_request);
+
+  g_clear_pointer (&request->impl_request, xdp_impl_request_unref);
+  request->impl_request = impl_request;
 }
 
-static void
-xdp_close_requests_in_thread_func (GTask        *task,
-                                   gpointer      source_object,
-                                   gpointer      task_data,
-                                   GCancellable *cancellable)
+/* Closes all requests of @sender. This blocks on the backends, so it must
+ * not be called from the main thread.
+ */
+void
+close_requests_for_sender (const char *sender)
 {
-  const char *sender = (const char *)task_data;
   GSList *list = NULL;
   GSList *l;
+  GHashTable *sender_requests;
   GHashTableIter iter;
   XdpRequest *request;
 
   G_LOCK (requests);
-  if (requests)
+  sender_requests = requests_by_sender ? g_hash_table_lookup (requests_by_sender, sender) : NULL;
+  if (sender_requests)
     {
-      g_hash_table_iter_init (&iter, requests);
-      while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&request))
-        {
-          if (strcmp (sender, request->sender) == 0)
-            list = g_slist_prepend (list, g_object_ref (request));
-        }
+      g_hash_table_iter_init (&iter, sender_requests);
+      while (g_hash_table_iter_next (&iter, (gpointer *)&request, NULL))
+        list = g_slist_prepend (list, g_object_ref (request));
     }
   G_UNLOCK (requests);
 
@@ -334,24 +423,11 @@ xdp_close_requests_in_thread_func (GTask        *task,
       if (request->exported)
         {
           if (request->impl_request)
-            xdp_dbus_impl_request_call_close_sync (request->impl_request, NULL, NULL);
+            xdp_impl_request_close_sync (request->impl_request, NULL, NULL);
 
           xdp_request_unexport (request);
         }
     }
 
   g_slist_free_full (list, g_object_unref);
-  g_task_return_boolean (task, TRUE);
 }
-
-void
-close_requests_for_sender (const char *sender)
-{
-  GTask *task;
-
-  task = g_task_new (NULL, NULL, NULL, NULL);
-  g_task_set_task_data (task, g_strdup (sender), g_free);
-  g_task_run_in_thread (task, xdp_close_requests_in_thread_func);
-  g_object_unref (task);
-}
-
@@ -34,6 +34,23 @@ typedef enum {
   XDG_DESKTOP_PORTAL_RESPONSE_OTHER
 } XdgDesktopPortalResponseEnum;
 
+/* Handle to the org.freedesktop.impl.portal.Request object of a backend;
+ * unlike a XdpDbusImplRequest proxy, creating one doesn't touch the bus. */
+typedef struct _XdpImplRequest XdpImplRequest;
+
+XdpImplRequest *xdp_impl_request_new (GDBusProxy *impl,
+                                      const char *object_path);
+
+XdpImplRequest *xdp_impl_request_ref (XdpImplRequest *impl_request);
+
+void xdp_impl_request_unref (XdpImplRequest *impl_request);
+
+gboolean xdp_impl_request_close_sync (XdpImplRequest  *impl_request,
+                                      GCancellable    *cancellable,
+                                      GError         **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (XdpImplRequest, xdp_impl_request_unref)
+
 typedef struct _XdpRequest
 {
   XdpDbusRequestSkeleton parent_instance;
@@ -44,7 +61,7 @@ typedef struct _XdpRequest
   GMutex mutex;
   XdpAppInfo *app_info;
 
-  XdpDbusImplRequest *impl_request;
+  XdpImplRequest *impl_request;
 } XdpRequest;
 
 typedef struct _XdpRequestClass
@@ -82,8 +99,8 @@ const char *xdp_request_get_object_path (XdpRequest *request);
 
 void close_requests_for_sender (const char *sender);
 
-void xdp_request_set_impl_request (XdpRequest         *request,
-                                   XdpDbusImplRequest *impl_request);
+void xdp_request_set_impl_request (XdpRequest     *request,
+                                   XdpImplRequest *impl_request);
 
 static inline void
 auto_unlock_helper (GMutex **mutex)
@@ -0,0 +1,310 @@
+/*
+ * Copyright © 2024 Red Hat, Inc
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include "xdp-scheduler.h"
+#include "xdp-method-info.h"
+
+/* Method invocations are not handled with
+ * G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD,
+ * since that hands every call to the GTask thread pool, which keeps growing
+ * as long as handlers block on backend calls. Instead, the invocation is
+ * taken over in the g-authorize-method signal and queued on one of two
+ * bounded pools:
+ *
+ *  - the fast lane, for interfaces whose methods are cheap and must never
+ *    wait behind dialogs;
+ *  - the main lane for everything else. There, calls that don't create a
+ *    Request are run before request-based ones, and a single interface can
+ *    only occupy part of the pool.
+ *
+ * Closing requests and sessions is how callers cancel what keeps the other
+ * lanes busy, so those calls get a small lane of their own.
+ *
+ * Authorization runs in the worker thread as well, since looking up the
+ * app info of the caller may block.
+ */
+
+typedef enum
+{
+  PRIORITY_DEFAULT,
+  PRIORITY_LOW,
+} Priority;
+
+static const char * const fast_lane_interfaces[] = {
+  "org.freedesktop.portal.MemoryMonitor",
+  "org.freedesktop.portal.NetworkMonitor",
+  "org.freedesktop.portal.PowerProfileMonitor",
+  "org.freedesktop.portal.Realtime",
+  "org.freedesktop.portal.Settings",
+  NULL
+};
+
+static const char * const close_lane_interfaces[] = {
+  "org.freedesktop.portal.Request",
+  "org.freedesktop.portal.Session",
+  NULL
+};
+
+typedef struct
+{
+  XdpAuthorizeFunc authorize;
+  gpointer user_data;
+} Handler;
+
+typedef struct _Lane Lane;
+
+typedef struct
+{
+  Lane *lane;
+  guint running;
+  GQueue pending;
+} InterfaceQueue;
+
+struct _Lane
+{
+  GThreadPool *pool;
+  GHashTable *queues; /* interface name -> InterfaceQueue */
+  guint max_per_interface;
+};
+
+typedef struct
+{
+  GDBusInterfaceSkeleton *skeleton;
+  GDBusMethodInvocation *invocation;
+  Handler *handler;
+  InterfaceQueue *queue;
+  Priority priority;
+  guint64 serial;
+} Job;
+
+/* Protects the interface queues of both lanes */
+G_LOCK_DEFINE_STATIC (scheduler);
+static Lane main_lane;
+static Lane fast_lane;
+static Lane close_lane;
+static guint64 next_serial;
+
+static void
+job_free (Job *job)
+{
+  g_clear_object (&job->skeleton);
+  g_clear_object (&job->invocation);
+  g_free (job);
+}
+
+static int
+compare_jobs (gconstpointer a,
+              gconstpointer b,
+              gpointer      user_data)
+{
+  const Job *job_a = a;
+  const Job *job_b = b;
+
+  if (job_a->priority != job_b->priority)
+    return job_a->priority < job_b->priority ? -1 : 1;
+
+  return job_a->serial < job_b->serial ? -1 : 1;
+}
+
+static void
+job_done (Job *job)
+{
+  InterfaceQueue *queue = job->queue;
+  Job *next;
+
+  G_LOCK (scheduler);
+
+  next = g_queue_pop_head (&queue->pending);
+  if (next)
+    g_thread_pool_push (queue->lane->pool, next, NULL);
+  else
+    queue->running--;
+
+  G_UNLOCK (scheduler);
+
+  job_free (job);
+}
+
+static void
+run_job (gpointer data,
+         gpointer user_data)
+{
+  Job *job = data;
+  GDBusMethodInvocation *invocation = job->invocation;
+  Handler *handler = job->handler;
+
+  /* Both the authorize function and the method handler take over the
+   * reference held by the job; keep one more around for the strings that
+   * are passed to the handler. */
+  g_object_ref (invocation);
+
+  if (handler->authorize (job->skeleton,
+                          g_steal_pointer (&job->invocation),
+                          handler->user_data))
+    {
+      const GDBusInterfaceVTable *vtable;
+
+      vtable = g_dbus_interface_skeleton_get_vtable (job->skeleton);
+      vtable->method_call (g_dbus_method_invocation_get_connection (invocation),
+                           g_dbus_method_invocation_get_sender (invocation),
+                           g_dbus_method_invocation_get_object_path (invocation),
+                           g_dbus_method_invocation_get_interface_name (invocation),
+                           g_dbus_method_invocation_get_method_name (invocation),
+                           g_dbus_method_invocation_get_parameters (invocation),
+                           invocation,
+                           job->skeleton);
+    }
+
+  g_object_unref (invocation);
+
+  job_done (job);
+}
+
+static void
+lane_init (Lane  *lane,
+           guint  max_threads,
+           guint  max_per_interface)
+{
+  lane->pool = g_thread_pool_new (run_job, lane, max_threads, FALSE, NULL);
+  g_thread_pool_set_sort_function (lane->pool, compare_jobs, NULL);
+  lane->queues = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  lane->max_per_interface = max_per_interface;
+}
+
+static void
+ensure_lanes (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      lane_init (&main_lane,
+                 XDP_SCHEDULER_MAX_MAIN_THREADS,
+                 XDP_SCHEDULER_MAX_THREADS_PER_INTERFACE);
+      lane_init (&fast_lane,
+                 XDP_SCHEDULER_MAX_FAST_THREADS,
+                 XDP_SCHEDULER_MAX_FAST_THREADS);
+      lane_init (&close_lane,
+                 XDP_SCHEDULER_MAX_CLOSE_THREADS,
+                 XDP_SCHEDULER_MAX_CLOSE_THREADS);
+      g_once_init_leave (&initialized, 1);
+    }
+}
+
+static Priority
+get_priority (GDBusMethodInvocation *invocation)
+{
+  const XdpMethodInfo *method_info;
+
+  method_info =
+    xdp_method_info_find (g_dbus_method_invocation_get_interface_name (invocation),
+                          g_dbus_method_invocation_get_method_name (invocation));
+
+  /* Request based methods usually end up showing a dialog, so they are
+   * the ones that can afford to wait */
+  if (method_info && method_info->uses_request)
+    return PRIORITY_LOW;
+
+  return PRIORITY_DEFAULT;
+}
+
+static gboolean
+schedule_invocation (GDBusInterfaceSkeleton *skeleton,
+                     GDBusMethodInvocation  *invocation,
+                     gpointer                user_data)
+{
+  const char *interface = g_dbus_method_invocation_get_interface_name (invocation);
+  InterfaceQueue *queue;
+  Lane *lane;
+  Job *job;
+
+  ensure_lanes ();
+
+  if (g_strv_contains (close_lane_interfaces, interface))
+    lane = &close_lane;
+  else if (g_strv_contains (fast_lane_interfaces, interface))
+    lane = &fast_lane;
+  else
+    lane = &main_lane;
+
+  job = g_new0 (Job, 1);
+  job->skeleton = g_object_ref (skeleton);
+  job->invocation = g_object_ref (invocation);
+  job->handler = user_data;
+  job->priority = get_priority (invocation);
+
+  G_LOCK (scheduler);
+
+  job->serial = next_serial++;
+
+  queue = g_hash_table_lookup (lane->queues, interface);
+  if (queue == NULL)
+    {
+      queue = g_new0 (InterfaceQueue, 1);
+      queue->lane = lane;
+      g_queue_init (&queue->pending);
+      g_hash_table_insert (lane->queues, g_strdup (interface), queue);
+    }
+  job->queue = queue;
+
+  if (queue->running < lane->max_per_interface)
+    {
+      queue->running++;
+      g_thread_pool_push (lane->pool, job, NULL);
+    }
+  else
+    {
+      g_debug ("Deferring call to %s.%s, too many calls in flight",
+               interface, g_dbus_method_invocation_get_method_name (invocation));
+      g_queue_insert_sorted (&queue->pending, job, compare_jobs, NULL);
+    }
+
+  G_UNLOCK (scheduler);
+
+  /* The job finishes the invocation from now on */
+  return FALSE;
+}
+
+/* Makes method calls on @skeleton run on the portal-wide worker pools
+ * rather than in the main thread. @authorize is called in the worker
+ * thread before the method handler, with the same semantics as the
+ * g-authorize-method signal.
+ */
+void
+xdp_scheduler_handle_skeleton (GDBusInterfaceSkeleton *skeleton,
+                               XdpAuthorizeFunc        authorize,
+                               gpointer                user_data)
+{
+  Handler *handler;
+
+  g_return_if_fail (G_IS_DBUS_INTERFACE_SKELETON (skeleton));
+  g_return_if_fail (!(g_dbus_interface_skeleton_get_flags (skeleton) &
+                      G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD));
+
+  handler = g_new0 (Handler, 1);
+  handler->authorize = authorize;
+  handler->user_data = user_data;
+
+  g_signal_connect_data (skeleton, "g-authorize-method",
+                         G_CALLBACK (schedule_invocation),
+                         handler, (GClosureNotify) g_free, 0);
+}
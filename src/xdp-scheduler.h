@@ -0,0 +1,39 @@
+/*
+ * Copyright © 2024 Red Hat, Inc
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+/* Thread limits of the lanes calls are scheduled on */
+#define XDP_SCHEDULER_MAX_MAIN_THREADS 16
+#define XDP_SCHEDULER_MAX_FAST_THREADS 4
+#define XDP_SCHEDULER_MAX_CLOSE_THREADS 4
+#define XDP_SCHEDULER_MAX_THREADS_PER_INTERFACE 6
+
+/* Same signature as the GDBusInterfaceSkeleton::g-authorize-method signal.
+ * If it returns FALSE, it must have finished @invocation itself. */
+typedef gboolean (*XdpAuthorizeFunc) (GDBusInterfaceSkeleton *skeleton,
+                                      GDBusMethodInvocation  *invocation,
+                                      gpointer                user_data);
+
+void xdp_scheduler_handle_skeleton (GDBusInterfaceSkeleton *skeleton,
+                                    XdpAuthorizeFunc        authorize,
+                                    gpointer                user_data);
@@ -257,6 +257,9 @@ xdp_sealed_fd_get_bytes (XdpSealedFd  *sealed_fd,
   g_autoptr(GMappedFile) mapped = NULL;
 
   mapped = g_mapped_file_new_from_fd (sealed_fd->fd, FALSE, error);
+  if (!mapped)
+    return NULL;
+
   return g_mapped_file_get_bytes (mapped);
 }
 
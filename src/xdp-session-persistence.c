@@ -25,6 +25,7 @@
 #include "xdp-session-persistence.h"
 
 static GMutex transient_permissions_lock;
+/* sender => (restore token => restore data) */
 static GHashTable *transient_permissions;
 
 #define RESTORE_DATA_TYPE "(suv)"
@@ -35,16 +36,28 @@ xdp_session_persistence_set_transient_permissions (XdpSession *session,
                                                    GVariant *restore_data)
 {
   g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&transient_permissions_lock);
+  GHashTable *sender_permissions;
 
   if (!transient_permissions)
     {
       transient_permissions =
+        g_hash_table_new_full (g_str_hash, g_str_equal,
+                               g_free, (GDestroyNotify) g_hash_table_unref);
+    }
+
+  sender_permissions = g_hash_table_lookup (transient_permissions, session->sender);
+  if (!sender_permissions)
+    {
+      sender_permissions =
         g_hash_table_new_full (g_str_hash, g_str_equal,
                                g_free, (GDestroyNotify) g_variant_unref);
+      g_hash_table_insert (transient_permissions,
+                           g_strdup (session->sender),
+                           sender_permissions);
     }
 
-  g_hash_table_insert (transient_permissions,
-                       g_strdup_printf ("%s/%s", session->sender, restore_token),
+  g_hash_table_insert (sender_permissions,
+                       g_strdup (restore_token),
                        g_variant_ref (restore_data));
 }
 
@@ -53,36 +66,29 @@ xdp_session_persistence_delete_transient_permissions (XdpSession *session,
                                                       const char *restore_token)
 {
   g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&transient_permissions_lock);
-  g_autofree char *id = NULL;
+  GHashTable *sender_permissions;
 
   if (!transient_permissions)
     return;
 
-  id = g_strdup_printf ("%s/%s", session->sender, restore_token);
-  g_hash_table_remove (transient_permissions, id);
+  sender_permissions = g_hash_table_lookup (transient_permissions, session->sender);
+  if (!sender_permissions)
+    return;
+
+  g_hash_table_remove (sender_permissions, restore_token);
+  if (g_hash_table_size (sender_permissions) == 0)
+    g_hash_table_remove (transient_permissions, session->sender);
 }
 
 void
 xdp_session_persistence_delete_transient_permissions_for_sender (const char *sender_name)
 {
-
-  g_autoptr(GMutexLocker) locker = NULL;
-  GHashTableIter iter;
-  const char *key;
-
-  locker = g_mutex_locker_new (&transient_permissions_lock);
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&transient_permissions_lock);
 
   if (!transient_permissions)
     return;
 
-  g_hash_table_iter_init (&iter, transient_permissions);
-  while (g_hash_table_iter_next (&iter, (gpointer *) &key, NULL))
-    {
-      g_auto(GStrv) split = g_strsplit (key, "/", 2);
-
-      if (split && split[0] && g_strcmp0 (split[0], sender_name) == 0)
-        g_hash_table_iter_remove (&iter);
-    }
+  g_hash_table_remove (transient_permissions, sender_name);
 }
 
 GVariant *
@@ -90,14 +96,17 @@ xdp_session_persistence_get_transient_permissions (XdpSession *session,
                                                    const char *restore_token)
 {
   g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&transient_permissions_lock);
-  g_autofree char *id = NULL;
+  GHashTable *sender_permissions;
   GVariant *permissions;
 
   if (!transient_permissions)
     return NULL;
 
-  id = g_strdup_printf ("%s/%s", session->sender, restore_token);
-  permissions = g_hash_table_lookup (transient_permissions, id);
+  sender_permissions = g_hash_table_lookup (transient_permissions, session->sender);
+  if (!sender_permissions)
+    return NULL;
+
+  permissions = g_hash_table_lookup (sender_permissions, restore_token);
   return permissions ? g_variant_ref (permissions) : NULL;
 }
 
@@ -21,6 +21,7 @@
 #include "xdp-session.h"
 #include "xdp-request.h"
 #include "xdp-call.h"
+#include "xdp-scheduler.h"
 
 #include <string.h>
 
@@ -42,6 +43,8 @@ static GParamSpec *obj_props[PROP_LAST];
 
 G_LOCK_DEFINE (sessions);
 static GHashTable *sessions;
+/* sender => set of XdpSession, protected by the sessions lock */
+static GHashTable *sessions_by_sender;
 
 static void g_initable_iface_init (GInitableIface *iface);
 static void xdp_session_skeleton_iface_init (XdpDbusSessionIface *iface);
@@ -154,16 +157,34 @@ xdp_session_unexport (XdpSession *session)
 void
 xdp_session_register (XdpSession *session)
 {
+  GHashTable *sender_sessions;
+
   G_LOCK (sessions);
   g_hash_table_insert (sessions, session->id, session);
+
+  sender_sessions = g_hash_table_lookup (sessions_by_sender, session->sender);
+  if (sender_sessions == NULL)
+    {
+      sender_sessions = g_hash_table_new (NULL, NULL);
+      g_hash_table_insert (sessions_by_sender, g_strdup (session->sender), sender_sessions);
+    }
+  g_hash_table_add (sender_sessions, session);
   G_UNLOCK (sessions);
 }
 
 static void
 xdp_session_unregister (XdpSession *session)
 {
+  GHashTable *sender_sessions;
+
   G_LOCK (sessions);
   g_hash_table_remove (sessions, session->id);
+
+  sender_sessions = g_hash_table_lookup (sessions_by_sender, session->sender);
+  if (sender_sessions &&
+      g_hash_table_remove (sender_sessions, session) &&
+      g_hash_table_size (sender_sessions) == 0)
+    g_hash_table_remove (sessions_by_sender, session->sender);
   G_UNLOCK (sessions);
 }
 
@@ -234,27 +255,25 @@ xdp_session_skeleton_iface_init (XdpDbusSessionIface *iface)
   iface->handle_close = handle_close;
 }
 
-static void
-close_sessions_in_thread_func (GTask *task,
-                               gpointer source_object,
-                               gpointer task_data,
-                               GCancellable *cancellable)
+/* Closes all sessions of @sender. This blocks on the backends, so it must
+ * not be called from the main thread.
+ */
+void
+close_sessions_for_sender (const char *sender)
 {
-  const char *sender = (const char *)task_data;
   GSList *list = NULL;
   GSList *l;
+  GHashTable *sender_sessions;
   GHashTableIter iter;
   XdpSession *session;
 
   G_LOCK (sessions);
-  if (sessions)
+  sender_sessions = sessions_by_sender ? g_hash_table_lookup (sessions_by_sender, sender) : NULL;
+  if (sender_sessions)
     {
-      g_hash_table_iter_init (&iter, sessions);
-      while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&session))
-        {
-          if (strcmp (sender, session->sender) == 0)
-            list = g_slist_prepend (list, g_object_ref (session));
-        }
+      g_hash_table_iter_init (&iter, sender_sessions);
+      while (g_hash_table_iter_next (&iter, (gpointer *)&session, NULL))
+        list = g_slist_prepend (list, g_object_ref (session));
     }
   G_UNLOCK (sessions);
 
@@ -267,17 +286,6 @@ close_sessions_in_thread_func (GTask *task,
     }
 
   g_slist_free_full (list, g_object_unref);
-  g_task_return_boolean (task, TRUE);
-}
-
-void
-close_sessions_for_sender (const char *sender)
-{
-  g_autoptr(GTask) task = NULL;
-
-  task = g_task_new (NULL, NULL, NULL, NULL);
-  g_task_set_task_data (task, g_strdup (sender), g_free);
-  g_task_run_in_thread (task, close_sessions_in_thread_func);
 }
 
 static void
@@ -356,11 +364,9 @@ xdp_session_initable_init (GInitable     *initable,
 
   session->id = g_steal_pointer (&id);
 
-  g_dbus_interface_skeleton_set_flags (G_DBUS_INTERFACE_SKELETON (session),
-                                       G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD);
-  g_signal_connect (session, "g-authorize-method",
-                    G_CALLBACK (xdp_session_authorize_callback),
-                    session->sender);
+  xdp_scheduler_handle_skeleton (G_DBUS_INTERFACE_SKELETON (session),
+                                 xdp_session_authorize_callback,
+                                 session->sender);
 
   return TRUE;
 }
@@ -485,6 +491,8 @@ xdp_session_class_init (XdpSessionClass *klass)
 
   sessions = g_hash_table_new_full (g_str_hash, g_str_equal,
                                     NULL, NULL);
+  sessions_by_sender = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                              g_free, (GDestroyNotify) g_hash_table_unref);
 
   gobject_class = G_OBJECT_CLASS (klass);
   gobject_class->finalize = xdp_session_finalize;
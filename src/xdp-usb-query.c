@@ -211,3 +211,249 @@ xdp_usb_query_from_string (XdpUsbQueryType  query_type,
 
   return g_steal_pointer (&usb_query);
 }
+
+/* Queries are compiled to the identifiers a device must have. The rules of
+ * a query apply one after the other, and "all" resets the ones before it.
+ */
+struct _XdpUsbMatcher
+{
+  GArray *enumerable; /* XdpUsbDeviceDescriptor */
+  GArray *hidden; /* XdpUsbDeviceDescriptor */
+};
+
+static gboolean
+require_field (XdpUsbDeviceDescriptor *required,
+               XdpUsbDeviceFields      field,
+               uint16_t               *required_value,
+               uint16_t                value)
+{
+  /* Requiring two different values can never match */
+  if ((required->fields & field) && *required_value != value)
+    return FALSE;
+
+  required->fields |= field;
+  *required_value = value;
+
+  return TRUE;
+}
+
+static gboolean
+compile_query (const XdpUsbQuery      *query,
+               XdpUsbDeviceDescriptor *out_required)
+{
+  XdpUsbDeviceDescriptor required = { 0, };
+  gboolean satisfiable = TRUE;
+
+  for (size_t i = 0; i < query->rules->len; i++)
+    {
+      XdpUsbRule *rule = g_ptr_array_index (query->rules, i);
+
+      switch (rule->rule_type)
+        {
+        case XDP_USB_RULE_TYPE_ALL:
+          required = (XdpUsbDeviceDescriptor) { 0, };
+          satisfiable = TRUE;
+          break;
+
+        case XDP_USB_RULE_TYPE_CLASS:
+          satisfiable &= require_field (&required,
+                                        XDP_USB_DEVICE_FIELD_CLASS,
+                                        &required.device_class,
+                                        rule->d.device_class.class);
+
+          if (rule->d.device_class.type == XDP_USB_RULE_CLASS_TYPE_CLASS_SUBCLASS)
+            satisfiable &= require_field (&required,
+                                          XDP_USB_DEVICE_FIELD_SUBCLASS,
+                                          &required.device_subclass,
+                                          rule->d.device_class.subclass);
+          break;
+
+        case XDP_USB_RULE_TYPE_DEVICE:
+          satisfiable &= require_field (&required,
+                                        XDP_USB_DEVICE_FIELD_PRODUCT_ID,
+                                        &required.product_id,
+                                        rule->d.product.id);
+          break;
+
+        case XDP_USB_RULE_TYPE_VENDOR:
+          satisfiable &= require_field (&required,
+                                        XDP_USB_DEVICE_FIELD_VENDOR_ID,
+                                        &required.vendor_id,
+                                        rule->d.vendor.id);
+          break;
+
+        default:
+          g_assert_not_reached ();
+        }
+    }
+
+  *out_required = required;
+
+  return satisfiable;
+}
+
+XdpUsbMatcher *
+xdp_usb_matcher_new (const GPtrArray *queries)
+{
+  XdpUsbMatcher *matcher;
+
+  matcher = g_new0 (XdpUsbMatcher, 1);
+  matcher->enumerable = g_array_new (FALSE, FALSE, sizeof (XdpUsbDeviceDescriptor));
+  matcher->hidden = g_array_new (FALSE, FALSE, sizeof (XdpUsbDeviceDescriptor));
+
+  for (size_t i = 0; queries && i < queries->len; i++)
+    {
+      XdpUsbQuery *query = g_ptr_array_index (queries, i);
+      XdpUsbDeviceDescriptor required;
+
+      if (!query)
+        continue;
+
+      /* Queries that can't match any device are left out */
+      if (!compile_query (query, &required))
+        continue;
+
+      switch (query->query_type)
+        {
+        case XDP_USB_QUERY_TYPE_ENUMERABLE:
+          g_array_append_val (matcher->enumerable, required);
+          break;
+
+        case XDP_USB_QUERY_TYPE_HIDDEN:
+          g_array_append_val (matcher->hidden, required);
+          break;
+        }
+    }
+
+  return matcher;
+}
+
+void
+xdp_usb_matcher_free (XdpUsbMatcher *matcher)
+{
+  g_return_if_fail (matcher != NULL);
+
+  g_clear_pointer (&matcher->enumerable, g_array_unref);
+  g_clear_pointer (&matcher->hidden, g_array_unref);
+  g_free (matcher);
+}
+
+static inline gboolean
+descriptor_matches (const XdpUsbDeviceDescriptor *required,
+                    const XdpUsbDeviceDescriptor *descriptor)
+{
+  if ((descriptor->fields & required->fields) != required->fields)
+    return FALSE;
+
+  if ((required->fields & XDP_USB_DEVICE_FIELD_VENDOR_ID) &&
+      descriptor->vendor_id != required->vendor_id)
+    return FALSE;
+
+  if ((required->fields & XDP_USB_DEVICE_FIELD_PRODUCT_ID) &&
+      descriptor->product_id != required->product_id)
+    return FALSE;
+
+  if ((required->fields & XDP_USB_DEVICE_FIELD_CLASS) &&
+      descriptor->device_class != required->device_class)
+    return FALSE;
+
+  if ((required->fields & XDP_USB_DEVICE_FIELD_SUBCLASS) &&
+      descriptor->device_subclass != required->device_subclass)
+    return FALSE;
+
+  return TRUE;
+}
+
+/* A device matches if any of the enumerable queries matches it, and none
+ * of the hidden ones does.
+ */
+gboolean
+xdp_usb_matcher_match (const XdpUsbMatcher          *matcher,
+                       const XdpUsbDeviceDescriptor *descriptor)
+{
+  gboolean match = FALSE;
+
+  g_return_val_if_fail (matcher != NULL, FALSE);
+  g_return_val_if_fail (descriptor != NULL, FALSE);
+
+  for (size_t i = 0; i < matcher->hidden->len; i++)
+    {
+      if (descriptor_matches (&g_array_index (matcher->hidden, XdpUsbDeviceDescriptor, i),
+                              descriptor))
+        return FALSE;
+    }
+
+  for (size_t i = 0; i < matcher->enumerable->len && !match; i++)
+    match = descriptor_matches (&g_array_index (matcher->enumerable, XdpUsbDeviceDescriptor, i),
+                                descriptor);
+
+  return match;
+}
+
+#define INDEX_KEY_VENDOR(vendor_id) ((1u << 16) | (vendor_id))
+#define INDEX_KEY_CLASS(device_class) ((2u << 16) | (device_class))
+
+static guint
+required_index_key (const XdpUsbDeviceDescriptor *required)
+{
+  if (required->fields & XDP_USB_DEVICE_FIELD_VENDOR_ID)
+    return INDEX_KEY_VENDOR (required->vendor_id);
+
+  if (required->fields & XDP_USB_DEVICE_FIELD_CLASS)
+    return INDEX_KEY_CLASS (required->device_class);
+
+  return XDP_USB_INDEX_KEY_ANY;
+}
+
+/* Returns the keys, without duplicates, under which a device that
+ * @matcher may match is found. Hidden queries only ever exclude devices,
+ * so they don't contribute any key.
+ */
+GArray *
+xdp_usb_matcher_get_index_keys (const XdpUsbMatcher *matcher)
+{
+  GArray *keys;
+
+  g_return_val_if_fail (matcher != NULL, NULL);
+
+  keys = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  for (size_t i = 0; i < matcher->enumerable->len; i++)
+    {
+      guint key;
+      gboolean found = FALSE;
+
+      key = required_index_key (&g_array_index (matcher->enumerable,
+                                                XdpUsbDeviceDescriptor, i));
+
+      for (size_t j = 0; j < keys->len && !found; j++)
+        found = g_array_index (keys, guint, j) == key;
+
+      if (!found)
+        g_array_append_val (keys, key);
+    }
+
+  return keys;
+}
+
+/* Fills @out_keys with the keys a matcher that may match @descriptor is
+ * filed under, and returns how many there are.
+ */
+size_t
+xdp_usb_device_descriptor_get_index_keys (const XdpUsbDeviceDescriptor *descriptor,
+                                          guint                         out_keys[XDP_USB_MAX_DEVICE_INDEX_KEYS])
+{
+  size_t n_keys = 0;
+
+  g_return_val_if_fail (descriptor != NULL, 0);
+
+  out_keys[n_keys++] = XDP_USB_INDEX_KEY_ANY;
+
+  if (descriptor->fields & XDP_USB_DEVICE_FIELD_VENDOR_ID)
+    out_keys[n_keys++] = INDEX_KEY_VENDOR (descriptor->vendor_id);
+
+  if (descriptor->fields & XDP_USB_DEVICE_FIELD_CLASS)
+    out_keys[n_keys++] = INDEX_KEY_CLASS (descriptor->device_class);
+
+  return n_keys;
+}
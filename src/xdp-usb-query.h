@@ -83,6 +83,44 @@ XdpUsbQuery *xdp_usb_query_from_string (XdpUsbQueryType  query_type,
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (XdpUsbQuery, xdp_usb_query_free);
 
+typedef enum
+{
+  XDP_USB_DEVICE_FIELD_VENDOR_ID = 1 << 0,
+  XDP_USB_DEVICE_FIELD_PRODUCT_ID = 1 << 1,
+  XDP_USB_DEVICE_FIELD_CLASS = 1 << 2,
+  XDP_USB_DEVICE_FIELD_SUBCLASS = 1 << 3,
+} XdpUsbDeviceFields;
+
+/* The identifiers of a device that queries are matched against. Fields
+ * that are not set in @fields are unknown. */
+typedef struct
+{
+  XdpUsbDeviceFields fields;
+  uint16_t vendor_id;
+  uint16_t product_id;
+  uint16_t device_class;
+  uint16_t device_subclass;
+} XdpUsbDeviceDescriptor;
+
+typedef struct _XdpUsbMatcher XdpUsbMatcher;
+
+XdpUsbMatcher *xdp_usb_matcher_new (const GPtrArray *queries);
+void xdp_usb_matcher_free (XdpUsbMatcher *matcher);
+gboolean xdp_usb_matcher_match (const XdpUsbMatcher          *matcher,
+                                const XdpUsbDeviceDescriptor *descriptor);
+
+/* Devices are looked up by vendor and by class, and matchers are filed
+ * under the vendors and classes their queries require. Matchers with a
+ * query that requires neither are filed under XDP_USB_INDEX_KEY_ANY. */
+#define XDP_USB_INDEX_KEY_ANY 0
+#define XDP_USB_MAX_DEVICE_INDEX_KEYS 3
+
+GArray *xdp_usb_matcher_get_index_keys (const XdpUsbMatcher *matcher);
+size_t xdp_usb_device_descriptor_get_index_keys (const XdpUsbDeviceDescriptor *descriptor,
+                                                 guint                         out_keys[XDP_USB_MAX_DEVICE_INDEX_KEYS]);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (XdpUsbMatcher, xdp_usb_matcher_free);
+
 gboolean
 xdp_validate_hex_uint16 (const char *value,
                          size_t      expected_length,
@@ -34,6 +34,7 @@
 #include <gio/gunixoutputstream.h>
 
 #include "xdp-utils.h"
+#include "xdp-validator.h"
 
 #define DBUS_NAME_DBUS "org.freedesktop.DBus"
 #define DBUS_INTERFACE_DBUS DBUS_NAME_DBUS
@@ -556,7 +557,6 @@ xdp_has_path_prefix (const char *str,
     }
 }
 
-#define VALIDATOR_INPUT_FD 3
 #define ICON_VALIDATOR_GROUP "Icon Validator"
 #define SOUND_VALIDATOR_GROUP "Sound Validator"
 
@@ -576,50 +576,222 @@ icon_type_to_string (XdpIconType icon_type)
     }
 }
 
-gboolean
-xdp_validate_icon (XdpSealedFd  *icon,
-                   XdpIconType   icon_type,
-                   char        **out_format,
-                   char        **out_size)
+#define MAX_ICON_VALIDATORS 2
+#define MAX_SOUND_VALIDATORS 1
+
+static XdpValidator *
+create_validator (const char *validator_path,
+                  const char *insecure_env,
+                  guint       max_workers)
 {
-  g_autofree char *format = NULL;
-  g_autoptr(GError) error = NULL;
-  const char *icon_validator = LIBEXECDIR "/xdg-desktop-portal-validate-icon";
-  const char *args[7];
-  int size;
+  const char *args[5];
   size_t i;
-  g_autofree char *output = NULL;
-  g_autoptr(GKeyFile) key_file = NULL;
 
-  if (g_getenv ("XDP_VALIDATE_ICON"))
-    icon_validator = g_getenv ("XDP_VALIDATE_ICON");
+  i = 0;
+  args[i++] = validator_path;
 
-  if (!g_file_test (icon_validator, G_FILE_TEST_EXISTS))
+  if (g_getenv (insecure_env) == NULL)
+    args[i++] = "--sandbox";
+
+  args[i++] = "--socket";
+  args[i++] = G_STRINGIFY (XDP_VALIDATOR_SOCKET_FD);
+  g_assert (i < G_N_ELEMENTS (args));
+  args[i++] = NULL;
+
+  return xdp_validator_new (args, max_workers);
+}
+
+static XdpValidator *
+get_icon_validator (void)
+{
+  static XdpValidator *icon_validator = NULL;
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
     {
-      g_warning ("Icon validation: %s not found, rejecting icon by default.", icon_validator);
+      const char *validator_path = LIBEXECDIR "/xdg-desktop-portal-validate-icon";
+
+      if (g_getenv ("XDP_VALIDATE_ICON"))
+        validator_path = g_getenv ("XDP_VALIDATE_ICON");
+
+      icon_validator = create_validator (validator_path,
+                                         "XDP_VALIDATE_ICON_INSECURE",
+                                         MAX_ICON_VALIDATORS);
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return icon_validator;
+}
+
+static XdpValidator *
+get_sound_validator (void)
+{
+  static XdpValidator *sound_validator = NULL;
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      const char *validator_path = LIBEXECDIR "/xdg-desktop-portal-validate-sound";
+
+      if (g_getenv ("XDP_VALIDATE_SOUND"))
+        validator_path = g_getenv ("XDP_VALIDATE_SOUND");
+
+      sound_validator = create_validator (validator_path,
+                                          "XDP_VALIDATE_SOUND_INSECURE",
+                                          MAX_SOUND_VALIDATORS);
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return sound_validator;
+}
+
+/* Apps tend to send the same icons and sounds over and over, e.g. with
+ * every notification. The contents of sealed fds can't change, so the
+ * verdicts of the validators are remembered by content hash.
+ */
+#define MAX_CACHED_VERDICTS 256
+
+typedef struct
+{
+  char *key;
+  gboolean valid;
+  char *format;
+  int size;
+} ValidationVerdict;
+
+G_LOCK_DEFINE_STATIC (verdicts);
+static GHashTable *verdicts; /* key -> link in verdicts_lru */
+static GQueue verdicts_lru = G_QUEUE_INIT; /* most recently used first */
+
+static void
+validation_verdict_free (ValidationVerdict *verdict)
+{
+  g_free (verdict->key);
+  g_free (verdict->format);
+  g_free (verdict);
+}
+
+static char *
+get_verdict_key (XdpSealedFd *sealed_fd,
+                 const char  *kind)
+{
+  g_autoptr(GBytes) bytes = NULL;
+  g_autofree char *checksum = NULL;
+
+  bytes = xdp_sealed_fd_get_bytes (sealed_fd, NULL);
+  if (!bytes)
+    return NULL;
+
+  checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, bytes);
+
+  return g_strconcat (kind, ":", checksum, NULL);
+}
+
+static gboolean
+lookup_verdict (const char  *key,
+                gboolean    *out_valid,
+                char       **out_format,
+                int         *out_size)
+{
+  ValidationVerdict *verdict;
+  GList *link;
+
+  G_LOCK (verdicts);
+
+  link = verdicts ? g_hash_table_lookup (verdicts, key) : NULL;
+  if (link == NULL)
+    {
+      G_UNLOCK (verdicts);
       return FALSE;
     }
 
-  i = 0;
-  args[i++] = icon_validator;
+  g_queue_unlink (&verdicts_lru, link);
+  g_queue_push_head_link (&verdicts_lru, link);
 
-  if (g_getenv ("XDP_VALIDATE_ICON_INSECURE") == NULL)
-    args[i++] = "--sandbox";
+  verdict = link->data;
+  *out_valid = verdict->valid;
+  if (out_format)
+    *out_format = g_strdup (verdict->format);
+  if (out_size)
+    *out_size = verdict->size;
 
-  args[i++] = "--fd";
-  args[i++] = G_STRINGIFY (VALIDATOR_INPUT_FD);
-  args[i++] = "--ruleset";
-  args[i++] = icon_type_to_string (icon_type);
-  g_assert (i < G_N_ELEMENTS (args));
-  args[i++] = NULL;
+  G_UNLOCK (verdicts);
+
+  return TRUE;
+}
+
+static void
+store_verdict (const char *key,
+               gboolean    valid,
+               const char *format,
+               int         size)
+{
+  ValidationVerdict *verdict;
+
+  G_LOCK (verdicts);
+
+  if (verdicts == NULL)
+    verdicts = g_hash_table_new (g_str_hash, g_str_equal);
+
+  /* Another thread may have validated the same file in the meantime */
+  if (g_hash_table_contains (verdicts, key))
+    {
+      G_UNLOCK (verdicts);
+      return;
+    }
 
-  output = xdp_spawn_full (args, xdp_sealed_fd_dup_fd (icon), VALIDATOR_INPUT_FD, &error);
+  verdict = g_new0 (ValidationVerdict, 1);
+  verdict->key = g_strdup (key);
+  verdict->valid = valid;
+  verdict->format = g_strdup (format);
+  verdict->size = size;
+
+  g_queue_push_head (&verdicts_lru, verdict);
+  g_hash_table_insert (verdicts, verdict->key, verdicts_lru.head);
+
+  while (g_queue_get_length (&verdicts_lru) > MAX_CACHED_VERDICTS)
+    {
+      ValidationVerdict *oldest = g_queue_pop_tail (&verdicts_lru);
+
+      g_hash_table_remove (verdicts, oldest->key);
+      validation_verdict_free (oldest);
+    }
+
+  G_UNLOCK (verdicts);
+}
+
+/* Returns whether the validator accepted @icon. @out_definitive is set
+ * when the verdict doesn't depend on transient failures, and can be
+ * remembered.
+ */
+static gboolean
+run_icon_validator (XdpSealedFd  *icon,
+                    XdpIconType   icon_type,
+                    char        **out_format,
+                    int          *out_size,
+                    gboolean     *out_definitive)
+{
+  g_autofree char *format = NULL;
+  g_autoptr(GError) error = NULL;
+  int size;
+  g_autofree char *output = NULL;
+  g_autoptr(GKeyFile) key_file = NULL;
+
+  *out_definitive = FALSE;
+
+  output = xdp_validator_run (get_icon_validator (),
+                              xdp_sealed_fd_get_fd (icon),
+                              icon_type_to_string (icon_type),
+                              &error);
   if (!output)
     {
       g_warning ("Icon validation: Rejecting icon because validator failed: %s", error->message);
+      *out_definitive = g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
       return FALSE;
     }
 
+  *out_definitive = TRUE;
+
   key_file = g_key_file_new ();
   if (!g_key_file_load_from_data (key_file, output, -1, G_KEY_FILE_NONE, &error))
     {
@@ -637,51 +809,81 @@ xdp_validate_icon (XdpSealedFd  *icon,
       return FALSE;
     }
 
-  if (out_format)
-    *out_format = g_steal_pointer (&format);
-  if (out_size)
-    *out_size = g_strdup_printf ("%d", size);
+  *out_format = g_steal_pointer (&format);
+  *out_size = size;
 
   return TRUE;
 }
 
 gboolean
-xdp_validate_sound (XdpSealedFd *sound)
+xdp_validate_icon (XdpSealedFd  *icon,
+                   XdpIconType   icon_type,
+                   char        **out_format,
+                   char        **out_size)
 {
-  const char *args[5];
-  g_autoptr(GError) error = NULL;
-  g_autoptr(GKeyFile) key_file = NULL;
-  g_autofree char *output = NULL;
-  const char *sound_validator = LIBEXECDIR "/xdg-desktop-portal-validate-sound";
-  gsize i;
+  g_autofree char *format = NULL;
+  const char *icon_validator = LIBEXECDIR "/xdg-desktop-portal-validate-icon";
+  g_autofree char *key = NULL;
+  gboolean definitive;
+  gboolean valid = FALSE;
+  int size = 0;
 
-  if (g_getenv ("XDP_VALIDATE_SOUND"))
-    sound_validator = g_getenv ("XDP_VALIDATE_SOUND");
+  if (g_getenv ("XDP_VALIDATE_ICON"))
+    icon_validator = g_getenv ("XDP_VALIDATE_ICON");
 
-  if (!g_file_test (sound_validator, G_FILE_TEST_EXISTS))
+  if (!g_file_test (icon_validator, G_FILE_TEST_EXISTS))
     {
-      g_warning ("Sound validation: %s not found, rejecting sound by default.", sound_validator);
+      g_warning ("Icon validation: %s not found, rejecting icon by default.", icon_validator);
       return FALSE;
     }
 
-  i = 0;
-  args[i++] = sound_validator;
+  key = get_verdict_key (icon, icon_type_to_string (icon_type));
 
-  if (g_getenv ("XDP_VALIDATE_SOUND_INSECURE") == NULL)
-    args[i++] = "--sandbox";
+  if (key && lookup_verdict (key, &valid, &format, &size))
+    {
+      g_debug ("Icon validation: Using cached verdict for %s", key);
+    }
+  else
+    {
+      valid = run_icon_validator (icon, icon_type, &format, &size, &definitive);
+      if (key && definitive)
+        store_verdict (key, valid, format, size);
+    }
 
-  args[i++] = "--fd";
-  args[i++] = G_STRINGIFY (VALIDATOR_INPUT_FD);
-  g_assert (i < G_N_ELEMENTS (args));
-  args[i++] = NULL;
+  if (!valid)
+    return FALSE;
 
-  output = xdp_spawn_full (args, xdp_sealed_fd_dup_fd (sound), VALIDATOR_INPUT_FD, &error);
+  if (out_format)
+    *out_format = g_steal_pointer (&format);
+  if (out_size)
+    *out_size = g_strdup_printf ("%d", size);
+
+  return TRUE;
+}
+
+static gboolean
+run_sound_validator (XdpSealedFd *sound,
+                     gboolean    *out_definitive)
+{
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GKeyFile) key_file = NULL;
+  g_autofree char *output = NULL;
+
+  *out_definitive = FALSE;
+
+  output = xdp_validator_run (get_sound_validator (),
+                              xdp_sealed_fd_get_fd (sound),
+                              "sound",
+                              &error);
   if (!output)
     {
       g_warning ("Sound validation: Rejecting sound because validator failed: %s", error->message);
+      *out_definitive = g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
       return FALSE;
     }
 
+  *out_definitive = TRUE;
+
   key_file = g_key_file_new ();
   if (!g_key_file_load_from_data (key_file, output, -1, G_KEY_FILE_NONE, &error))
     {
@@ -692,6 +894,38 @@ xdp_validate_sound (XdpSealedFd *sound)
   return TRUE;
 }
 
+gboolean
+xdp_validate_sound (XdpSealedFd *sound)
+{
+  const char *sound_validator = LIBEXECDIR "/xdg-desktop-portal-validate-sound";
+  g_autofree char *key = NULL;
+  gboolean definitive;
+  gboolean valid = FALSE;
+
+  if (g_getenv ("XDP_VALIDATE_SOUND"))
+    sound_validator = g_getenv ("XDP_VALIDATE_SOUND");
+
+  if (!g_file_test (sound_validator, G_FILE_TEST_EXISTS))
+    {
+      g_warning ("Sound validation: %s not found, rejecting sound by default.", sound_validator);
+      return FALSE;
+    }
+
+  key = get_verdict_key (sound, "sound");
+
+  if (key && lookup_verdict (key, &valid, NULL, NULL))
+    {
+      g_debug ("Sound validation: Using cached verdict for %s", key);
+      return valid;
+    }
+
+  valid = run_sound_validator (sound, &definitive);
+  if (key && definitive)
+    store_verdict (key, valid, NULL, 0);
+
+  return valid;
+}
+
 gboolean
 xdp_variant_contains_key (GVariant *dictionary,
                           const char *key)
@@ -1057,6 +1291,159 @@ find_pid (pid_t *pids,
   return FALSE;
 }
 
+/* Cache of (proc directory, pid namespace, pid inside of it) => pid outside
+ * of it, filled while scanning /proc or a task directory. A cached mapping
+ * is only used after checking that the outside pid still refers to a
+ * process in the same namespace with the same inside pid, which makes it
+ * immune to pid reuse. */
+typedef struct
+{
+  ino_t proc_dir;
+  ino_t pidns;
+  pid_t inside;
+} XdpPidMapKey;
+
+#define PID_MAP_CACHE_MAX_SIZE 4096
+
+G_LOCK_DEFINE_STATIC (pid_map_cache);
+static GHashTable *pid_map_cache;
+
+static guint
+pid_map_key_hash (gconstpointer key)
+{
+  const XdpPidMapKey *k = key;
+
+  return (guint) (k->proc_dir * 31 + k->pidns) ^ (guint) k->inside;
+}
+
+static gboolean
+pid_map_key_equal (gconstpointer a,
+                   gconstpointer b)
+{
+  const XdpPidMapKey *ka = a;
+  const XdpPidMapKey *kb = b;
+
+  return ka->proc_dir == kb->proc_dir &&
+         ka->pidns == kb->pidns &&
+         ka->inside == kb->inside;
+}
+
+static pid_t
+pid_map_cache_lookup (ino_t proc_dir,
+                      ino_t pidns,
+                      pid_t inside)
+{
+  XdpPidMapKey key = { proc_dir, pidns, inside };
+  pid_t outside = 0;
+
+  G_LOCK (pid_map_cache);
+  if (pid_map_cache)
+    outside = GPOINTER_TO_INT (g_hash_table_lookup (pid_map_cache, &key));
+  G_UNLOCK (pid_map_cache);
+
+  return outside;
+}
+
+static void
+pid_map_cache_insert (ino_t proc_dir,
+                      ino_t pidns,
+                      pid_t inside,
+                      pid_t outside)
+{
+  XdpPidMapKey *key;
+
+  G_LOCK (pid_map_cache);
+
+  if (pid_map_cache == NULL)
+    pid_map_cache = g_hash_table_new_full (pid_map_key_hash, pid_map_key_equal,
+                                           g_free, NULL);
+
+  /* Stale entries are only found on lookup, so keep the size bounded */
+  if (g_hash_table_size (pid_map_cache) >= PID_MAP_CACHE_MAX_SIZE)
+    g_hash_table_remove_all (pid_map_cache);
+
+  key = g_new (XdpPidMapKey, 1);
+  key->proc_dir = proc_dir;
+  key->pidns = pidns;
+  key->inside = inside;
+  g_hash_table_replace (pid_map_cache, key, GINT_TO_POINTER (outside));
+
+  G_UNLOCK (pid_map_cache);
+}
+
+static void
+pid_map_cache_remove (ino_t proc_dir,
+                      ino_t pidns,
+                      pid_t inside)
+{
+  XdpPidMapKey key = { proc_dir, pidns, inside };
+
+  G_LOCK (pid_map_cache);
+  if (pid_map_cache)
+    g_hash_table_remove (pid_map_cache, &key);
+  G_UNLOCK (pid_map_cache);
+}
+
+/* Checks that @outside, looked up in @proc_fd, is @inside in @pidns */
+static gboolean
+validate_pid_mapping (int    proc_fd,
+                      ino_t  pidns,
+                      pid_t  inside,
+                      pid_t  outside,
+                      uid_t *uid_out)
+{
+  g_autofd int pid_fd = -1;
+  char buf[20] = {0, };
+  pid_t current_inside = 0;
+  ino_t ns = 0;
+
+  snprintf (buf, sizeof (buf), "%u", (guint) outside);
+
+  pid_fd = openat (proc_fd, buf, O_RDONLY | O_NONBLOCK | O_DIRECTORY | O_CLOEXEC | O_NOCTTY);
+  if (pid_fd == -1)
+    return FALSE;
+
+  if (!xdp_pidfd_get_namespace (pid_fd, &ns, NULL) || ns != pidns)
+    return FALSE;
+
+  if (parse_status_file (pid_fd, &current_inside, uid_out) < 0)
+    return FALSE;
+
+  return current_inside == inside;
+}
+
+static gboolean
+set_mapped_pid (pid_t   *pids,
+                pid_t   *res,
+                guint    n_pids,
+                guint   *count,
+                pid_t    inside,
+                pid_t    outside,
+                uid_t    uid,
+                uid_t    target_uid,
+                GError **error)
+{
+  /* We got a match, let's make sure the real uids match as well */
+  if (uid != target_uid)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED,
+                           "Matching pid doesn't belong to the target user");
+      return FALSE;
+    }
+
+  /* this handles the first occurrence as well as duplicate entries */
+  for (guint i = 0; i < n_pids; i++)
+    {
+      if (pids[i] == inside && res[i] == 0)
+        {
+          res[i] = outside;
+          (*count)++;
+        }
+    }
+
+  return TRUE;
+}
+
 gboolean
 xdp_map_pids_full (DIR     *proc,
                    ino_t    pidns,
@@ -1065,14 +1452,41 @@ xdp_map_pids_full (DIR     *proc,
                    uid_t    target_uid,
                    GError **error)
 {
-  pid_t *res = NULL;
+  g_autofree pid_t *res = NULL;
   struct dirent *de;
+  struct stat proc_st_buf;
   guint count = 0;
 
-  res = g_alloca (sizeof (pid_t) * n_pids);
-  memset (res, 0, sizeof (pid_t) * n_pids);
+  res = g_new0 (pid_t, n_pids);
+
+  if (fstat (dirfd (proc), &proc_st_buf) != 0)
+    proc_st_buf.st_ino = 0;
+
+  /* Try the mappings we already know about before scanning */
+  for (guint i = 0; i < n_pids; i++)
+    {
+      pid_t outside;
+      uid_t uid = 0;
+
+      if (res[i] != 0)
+        continue;
+
+      outside = pid_map_cache_lookup (proc_st_buf.st_ino, pidns, pids[i]);
+      if (outside == 0)
+        continue;
+
+      if (!validate_pid_mapping (dirfd (proc), pidns, pids[i], outside, &uid))
+        {
+          pid_map_cache_remove (proc_st_buf.st_ino, pidns, pids[i]);
+          continue;
+        }
+
+      if (!set_mapped_pid (pids, res, n_pids, &count, pids[i], outside,
+                           uid, target_uid, error))
+        return FALSE;
+    }
 
-  while ((de = readdir (proc)) != NULL)
+  while (count < n_pids && (de = readdir (proc)) != NULL)
     {
       g_autofd int pid_fd = -1;
       pid_t outside = 0;
@@ -1103,27 +1517,16 @@ xdp_map_pids_full (DIR     *proc,
       if (r < 0)
         continue;
 
-      if (!find_pid (pids, n_pids, inside, &idx))
-        continue;
+      /* Remember every process of the namespace, it is likely that
+       * the same app asks about its other processes later on */
+      pid_map_cache_insert (proc_st_buf.st_ino, pidns, inside, outside);
 
-      /* We got a match, let's make sure the real uids match as well */
-      if (uid != target_uid)
-        {
-          g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED,
-                               "Matching pid doesn't belong to the target user");
-          return FALSE;
-        }
+      if (!find_pid (pids, n_pids, inside, &idx) || res[idx] != 0)
+        continue;
 
-      /* this handles the first occurrence, already identified by find_pid,
-       * as well as duplicate entries */
-      for (guint i = idx; i < n_pids; i++)
-        {
-          if (pids[i] == inside)
-            {
-              res[idx] = outside;
-              count++;
-            }
-        }
+      if (!set_mapped_pid (pids, res, n_pids, &count, inside, outside,
+                           uid, target_uid, error))
+        return FALSE;
     }
 
   if (count != n_pids)
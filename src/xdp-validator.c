@@ -0,0 +1,356 @@
+/*
+ * Copyright © 2024 Red Hat, Inc
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include "xdp-validator.h"
+
+/* Validators used to be spawned for every file, and then re-executed
+ * themselves inside bwrap. Instead, they are now started once with
+ * --socket and stay in their sandbox. They are sent one request at a time
+ * over a SOCK_SEQPACKET socket: a message with a serial number and the
+ * request (e.g. the icon ruleset), separated by a space, as payload and
+ * the file descriptor to validate attached. The reply is a single message
+ * starting with '0' on success, '1' if the file is invalid or '2' if it
+ * couldn't be validated, directly followed by the serial of the request
+ * and a newline, and then the same key file the validators print when run
+ * for a single file.
+ *
+ * The validators fork for every request, and the children don't have
+ * access to the socket, so a file can't affect the validation of the
+ * following ones. Workers that exit, stop responding or send a reply for
+ * another request are replaced.
+ */
+
+#define VALIDATOR_TIMEOUT_MS 10000
+#define VALIDATOR_MAX_REPLY_SIZE 4096
+
+typedef struct
+{
+  GSubprocess *subprocess;
+  int socket_fd;
+  guint64 serial;
+} ValidatorWorker;
+
+struct _XdpValidator
+{
+  char **argv;
+  guint max_workers;
+
+  GMutex mutex;
+  GCond cond;
+  GQueue idle_workers;
+  guint n_workers;
+};
+
+static void
+validator_worker_free (ValidatorWorker *worker)
+{
+  g_clear_fd (&worker->socket_fd, NULL);
+  if (worker->subprocess)
+    g_subprocess_force_exit (worker->subprocess);
+  g_clear_object (&worker->subprocess);
+  g_free (worker);
+}
+
+static ValidatorWorker *
+validator_worker_new (XdpValidator  *validator,
+                      GError       **error)
+{
+  g_autoptr(GSubprocessLauncher) launcher = NULL;
+  g_autoptr(GSubprocess) subprocess = NULL;
+  g_autofd int socket_fd = -1;
+  ValidatorWorker *worker;
+  int sockets[2];
+
+  if (socketpair (AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) < 0)
+    {
+      int saved_errno = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   "Failed to create validator socket: %s",
+                   g_strerror (saved_errno));
+      return NULL;
+    }
+
+  socket_fd = sockets[0];
+
+  launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_NONE);
+  g_subprocess_launcher_take_fd (launcher, sockets[1], XDP_VALIDATOR_SOCKET_FD);
+
+  subprocess = g_subprocess_launcher_spawnv (launcher,
+                                             (const char * const *) validator->argv,
+                                             error);
+  if (!subprocess)
+    return NULL;
+
+  g_debug ("Started validator %s (%s)",
+           validator->argv[0], g_subprocess_get_identifier (subprocess));
+
+  worker = g_new0 (ValidatorWorker, 1);
+  worker->subprocess = g_steal_pointer (&subprocess);
+  worker->socket_fd = g_steal_fd (&socket_fd);
+
+  return worker;
+}
+
+static ValidatorWorker *
+acquire_worker (XdpValidator  *validator,
+                GError       **error)
+{
+  ValidatorWorker *worker;
+
+  g_mutex_lock (&validator->mutex);
+
+  while (g_queue_is_empty (&validator->idle_workers) &&
+         validator->n_workers >= validator->max_workers)
+    g_cond_wait (&validator->cond, &validator->mutex);
+
+  worker = g_queue_pop_head (&validator->idle_workers);
+  if (worker == NULL)
+    validator->n_workers++;
+
+  g_mutex_unlock (&validator->mutex);
+
+  if (worker)
+    return worker;
+
+  worker = validator_worker_new (validator, error);
+  if (worker == NULL)
+    {
+      g_mutex_lock (&validator->mutex);
+      validator->n_workers--;
+      g_cond_signal (&validator->cond);
+      g_mutex_unlock (&validator->mutex);
+    }
+
+  return worker;
+}
+
+static void
+release_worker (XdpValidator    *validator,
+                ValidatorWorker *worker,
+                gboolean         reusable)
+{
+  g_mutex_lock (&validator->mutex);
+
+  if (reusable)
+    g_queue_push_head (&validator->idle_workers, worker);
+  else
+    validator->n_workers--;
+
+  g_cond_signal (&validator->cond);
+  g_mutex_unlock (&validator->mutex);
+
+  if (!reusable)
+    validator_worker_free (worker);
+}
+
+static gboolean
+send_request (ValidatorWorker  *worker,
+              int               fd,
+              const char       *request,
+              GError          **error)
+{
+  union {
+    char buf[CMSG_SPACE (sizeof (int))];
+    struct cmsghdr align;
+  } control;
+  g_autofree char *payload = NULL;
+  struct iovec iov;
+  struct msghdr msg = { 0 };
+  struct cmsghdr *cmsg;
+  ssize_t res;
+
+  memset (&control, 0, sizeof (control));
+
+  payload = g_strdup_printf ("%" G_GUINT64_FORMAT " %s", ++worker->serial, request);
+  iov.iov_base = payload;
+  iov.iov_len = strlen (payload);
+
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+  memcpy (CMSG_DATA (cmsg), &fd, sizeof (int));
+
+  do
+    res = sendmsg (worker->socket_fd, &msg, MSG_NOSIGNAL);
+  while (res < 0 && errno == EINTR);
+
+  if (res < 0)
+    {
+      int saved_errno = errno;
+
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_BROKEN_PIPE,
+                   "Failed to send request to validator: %s",
+                   g_strerror (saved_errno));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static char *
+receive_reply (ValidatorWorker  *worker,
+               GError          **error)
+{
+  char reply[VALIDATOR_MAX_REPLY_SIZE + 1];
+  struct pollfd pfd = { worker->socket_fd, POLLIN, 0 };
+  char *end;
+  ssize_t res;
+
+  do
+    res = poll (&pfd, 1, VALIDATOR_TIMEOUT_MS);
+  while (res < 0 && errno == EINTR);
+
+  if (res == 0)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                   "Validator did not respond in time");
+      return NULL;
+    }
+
+  do
+    res = recv (worker->socket_fd, reply, VALIDATOR_MAX_REPLY_SIZE, 0);
+  while (res < 0 && errno == EINTR);
+
+  if (res <= 0)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_BROKEN_PIPE,
+                   "Validator exited: %s",
+                   res < 0 ? g_strerror (errno) : "Connection closed");
+      return NULL;
+    }
+
+  reply[res] = '\0';
+
+  if (!g_ascii_isdigit (reply[1]) ||
+      g_ascii_strtoull (reply + 1, &end, 10) != worker->serial ||
+      *end != '\n')
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                   "Validator sent a reply to another request");
+      return NULL;
+    }
+
+  if (reply[0] == '1')
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "Validator rejected the file");
+      return NULL;
+    }
+  else if (reply[0] != '0')
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_BUSY,
+                   "Validator couldn't validate the file");
+      return NULL;
+    }
+
+  return g_strdup (end + 1);
+}
+
+/* Sends @fd to one of the workers of @validator, and returns its output,
+ * or NULL if the file was rejected or couldn't be validated.
+ */
+char *
+xdp_validator_run (XdpValidator  *validator,
+                   int            fd,
+                   const char    *request,
+                   GError       **error)
+{
+  g_autoptr(GError) local_error = NULL;
+  int attempt;
+
+  g_return_val_if_fail (request != NULL && *request != '\0', NULL);
+
+  /* A worker that died since its last request is only noticed now, so
+   * give the request a second chance with a fresh one */
+  for (attempt = 0; attempt < 2; attempt++)
+    {
+      ValidatorWorker *worker;
+      char *output;
+
+      g_clear_error (&local_error);
+
+      worker = acquire_worker (validator, error);
+      if (worker == NULL)
+        return NULL;
+
+      if (send_request (worker, fd, request, &local_error) &&
+          (output = receive_reply (worker, &local_error)) != NULL)
+        {
+          release_worker (validator, worker, TRUE);
+          return output;
+        }
+
+      if (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA) ||
+          g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_BUSY))
+        {
+          release_worker (validator, worker, TRUE);
+          break;
+        }
+
+      g_debug ("Replacing validator %s: %s", validator->argv[0], local_error->message);
+      release_worker (validator, worker, FALSE);
+
+      if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_BROKEN_PIPE))
+        break;
+    }
+
+  g_propagate_error (error, g_steal_pointer (&local_error));
+  return NULL;
+}
+
+/* Creates a pool of at most @max_workers validators, started with @argv
+ * when needed. @argv must make the validator serve requests on
+ * XDP_VALIDATOR_SOCKET_FD.
+ */
+XdpValidator *
+xdp_validator_new (const char * const *argv,
+                   guint               max_workers)
+{
+  XdpValidator *validator;
+
+  g_return_val_if_fail (argv != NULL && argv[0] != NULL, NULL);
+  g_return_val_if_fail (max_workers > 0, NULL);
+
+  validator = g_new0 (XdpValidator, 1);
+  validator->argv = g_strdupv ((char **) argv);
+  validator->max_workers = max_workers;
+  g_mutex_init (&validator->mutex);
+  g_cond_init (&validator->cond);
+  g_queue_init (&validator->idle_workers);
+
+  return validator;
+}
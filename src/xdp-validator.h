@@ -0,0 +1,36 @@
+/*
+ * Copyright © 2024 Red Hat, Inc
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+/* The file descriptor the validators receive their socket on */
+#define XDP_VALIDATOR_SOCKET_FD 3
+
+typedef struct _XdpValidator XdpValidator;
+
+XdpValidator *xdp_validator_new (const char * const *argv,
+                                 guint               max_workers);
+
+char *xdp_validator_run (XdpValidator  *validator,
+                         int            fd,
+                         const char    *request,
+                         GError       **error);
@@ -31,6 +31,7 @@ def load(mock, parameters={}):
         "force-clipboard-enabled", False
     )
     mock.fail_connect_to_eis: bool = parameters.get("fail-connect-to-eis", False)
+    mock.devices: int = parameters.get("devices", 0)
     mock.AddProperties(
         MAIN_IFACE,
         dbus.Dictionary(
@@ -136,6 +137,9 @@ def Start(
         if self.force_clipoboard_enabled:
             response.results["clipboard_enabled"] = True
 
+        if self.devices:
+            response.results["devices"] = dbus.UInt32(self.devices)
+
         request = ImplRequest(self, BUS_NAME, handle)
 
         if self.expect_close:
@@ -183,3 +187,35 @@ def ConnectToEIS(self, session_handle, app_id, options):
     except Exception as e:
         logger.critical(e)
         raise e
+
+
+@dbus.service.method(
+    MAIN_IFACE,
+    in_signature="oa{sv}dd",
+    out_signature="",
+)
+def NotifyPointerMotion(self, session_handle, options, dx, dy):
+    logger.debug(f"NotifyPointerMotion({session_handle}, {options}, {dx}, {dy})")
+    assert session_handle in self.sessions
+
+
+@dbus.service.method(
+    MAIN_IFACE,
+    in_signature="oa{sv}iu",
+    out_signature="",
+)
+def NotifyKeyboardKeycode(self, session_handle, options, keycode, state):
+    logger.debug(
+        f"NotifyKeyboardKeycode({session_handle}, {options}, {keycode}, {state})"
+    )
+    assert session_handle in self.sessions
+
+
+@dbus.service.method(
+    MAIN_IFACE,
+    in_signature="oa{sv}a(sv)",
+    out_signature="",
+)
+def NotifyEvents(self, session_handle, options, events):
+    logger.debug(f"NotifyEvents({session_handle}, {options}, {events})")
+    assert session_handle in self.sessions
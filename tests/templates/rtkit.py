@@ -0,0 +1,34 @@
+# SPDX-License-Identifier: LGPL-2.1-or-later
+
+from tests.templates import init_template_logger
+import dbus
+
+BUS_NAME = "org.freedesktop.RealtimeKit1"
+MAIN_OBJ = "/org/freedesktop/RealtimeKit1"
+MAIN_IFACE = "org.freedesktop.RealtimeKit1"
+SYSTEM_BUS = True
+VERSION = 1
+
+logger = init_template_logger(__name__)
+
+
+def load(mock, parameters={}):
+    logger.debug(f"Loading parameters: {parameters}")
+
+    mock.AddProperties(
+        MAIN_IFACE,
+        dbus.Dictionary(
+            {
+                "MaxRealtimePriority": dbus.Int32(20),
+                "MinNiceLevel": dbus.Int32(-15),
+                "RTTimeUSecMax": dbus.Int64(200000),
+            }
+        ),
+    )
+    mock.AddMethods(
+        MAIN_IFACE,
+        [
+            ("MakeThreadRealtimeWithPID", "ttu", "", ""),
+            ("MakeThreadHighPriorityWithPID", "tti", "", ""),
+        ],
+    )
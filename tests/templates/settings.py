@@ -0,0 +1,112 @@
+# SPDX-License-Identifier: LGPL-2.1-or-later
+#
+# This file is formatted with Python Black
+
+from tests.templates import init_template_logger
+import dbus.service
+import dbus
+
+from gi.repository import GLib
+
+
+BUS_NAME = "org.freedesktop.impl.portal.Test"
+MAIN_OBJ = "/org/freedesktop/portal/desktop"
+SYSTEM_BUS = False
+MAIN_IFACE = "org.freedesktop.impl.portal.Settings"
+VERSION = 1
+
+
+logger = init_template_logger(__name__)
+
+
+def load(mock, parameters={}):
+    logger.debug(f"Loading parameters: {parameters}")
+
+    mock.read_all_delay: int = parameters.get("read-all-delay", 0)
+    mock.settings = {
+        namespace: dict(values)
+        for namespace, values in parameters.get("settings", {}).items()
+    }
+    # Settings that are only returned by Read(), not by ReadAll()
+    mock.read_only_settings = {
+        namespace: dict(values)
+        for namespace, values in parameters.get("read-only-settings", {}).items()
+    }
+    mock.AddProperties(
+        MAIN_IFACE,
+        dbus.Dictionary(
+            {
+                "version": dbus.UInt32(parameters.get("version", VERSION)),
+            }
+        ),
+    )
+
+
+def namespace_matches(namespace, patterns):
+    if not patterns:
+        return True
+
+    for pattern in patterns:
+        if pattern == "":
+            return True
+        if pattern.endswith("*"):
+            if namespace.startswith(pattern[:-1]):
+                return True
+        elif namespace == pattern:
+            return True
+
+    return False
+
+
+@dbus.service.method(
+    MAIN_IFACE,
+    in_signature="as",
+    out_signature="a{sa{sv}}",
+    async_callbacks=("cb_success", "cb_error"),
+)
+def ReadAll(self, namespaces, cb_success, cb_error):
+    try:
+        logger.debug(f"ReadAll({namespaces})")
+
+        value = dbus.Dictionary(
+            {
+                namespace: dbus.Dictionary(values, signature="sv")
+                for namespace, values in self.settings.items()
+                if namespace_matches(namespace, namespaces)
+            },
+            signature="sa{sv}",
+        )
+
+        if self.read_all_delay > 0:
+
+            def reply():
+                cb_success(value)
+                return False
+
+            logger.debug(f"scheduling delay of {self.read_all_delay}")
+            GLib.timeout_add(self.read_all_delay, reply)
+        else:
+            cb_success(value)
+    except Exception as e:
+        logger.critical(e)
+        cb_error(e)
+
+
+@dbus.service.method(
+    MAIN_IFACE,
+    in_signature="ss",
+    out_signature="v",
+)
+def Read(self, namespace, key):
+    logger.debug(f"Read({namespace}, {key})")
+
+    for settings in (self.settings, self.read_only_settings):
+        try:
+            return settings[namespace][key]
+        except KeyError:
+            pass
+
+    raise dbus.exceptions.DBusException(
+        f"Unknown setting {namespace} {key}",
+        name="org.freedesktop.portal.Error.NotFound",
+    )
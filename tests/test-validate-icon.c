@@ -0,0 +1,178 @@
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#define BENCHMARK_ITERATIONS 20
+
+typedef struct
+{
+  const char *name;
+  const char *format;
+  int width;
+  int height;
+  gboolean valid;
+} IconSample;
+
+/* A small corpus of what apps typically send, and of what they shouldn't */
+static const IconSample samples[] = {
+  { "small-png", "png", 48, 48, TRUE },
+  { "large-png", "png", 512, 512, TRUE },
+  { "jpeg", "jpeg", 256, 256, TRUE },
+  { "svg", "svg", 128, 128, TRUE },
+  { "oversized-png", "png", 4096, 4096, FALSE },
+  { "non-square-png", "png", 1024, 512, FALSE },
+  { "oversized-jpeg", "jpeg", 3000, 3000, FALSE },
+  { "oversized-svg", "svg", 16384, 16384, FALSE },
+};
+
+static char *tmpdir;
+
+static char *
+write_sample (const IconSample *sample)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree char *path = NULL;
+  g_autofree char *filename = NULL;
+
+  filename = g_strdup_printf ("%s.%s", sample->name, sample->format);
+  path = g_build_filename (tmpdir, filename, NULL);
+
+  if (g_str_equal (sample->format, "svg"))
+    {
+      g_autofree char *svg = NULL;
+
+      svg = g_strdup_printf ("<svg xmlns=\"http://www.w3.org/2000/svg\" "
+                             "width=\"%d\" height=\"%d\">"
+                             "<circle cx=\"50%%\" cy=\"50%%\" r=\"40%%\" fill=\"#3584e4\"/>"
+                             "</svg>",
+                             sample->width, sample->height);
+      g_file_set_contents (path, svg, -1, &error);
+    }
+  else
+    {
+      g_autoptr(GdkPixbuf) pixbuf = NULL;
+      guchar *pixels;
+      int rowstride;
+
+      pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8,
+                               sample->width, sample->height);
+      pixels = gdk_pixbuf_get_pixels (pixbuf);
+      rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+
+      /* A gradient, so that the data doesn't compress to nothing */
+      for (int y = 0; y < sample->height; y++)
+        for (int x = 0; x < sample->width; x++)
+          {
+            guchar *p = pixels + y * rowstride + x * 3;
+
+            p[0] = x & 0xff;
+            p[1] = y & 0xff;
+            p[2] = (x ^ y) & 0xff;
+          }
+
+      gdk_pixbuf_save (pixbuf, path, sample->format, &error, NULL);
+    }
+
+  g_assert_no_error (error);
+
+  return g_steal_pointer (&path);
+}
+
+static gboolean
+run_validator (const char *path)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree char *output = NULL;
+  const char *argv[] = {
+    g_getenv ("XDP_VALIDATE_ICON"),
+    "--ruleset", "desktop",
+    "--path", path,
+    NULL
+  };
+  int status;
+
+  g_spawn_sync (NULL, (char **) argv, NULL,
+                G_SPAWN_STDERR_TO_DEV_NULL,
+                NULL, NULL, &output, NULL, &status, &error);
+  g_assert_no_error (error);
+
+  return g_spawn_check_wait_status (status, NULL);
+}
+
+static void
+test_validate_icon_sample (gconstpointer data)
+{
+  const IconSample *sample = data;
+  g_autofree char *path = NULL;
+
+  path = write_sample (sample);
+  g_assert_cmpint (run_validator (path), ==, sample->valid);
+
+  g_unlink (path);
+}
+
+static void
+test_validate_icon_benchmark (gconstpointer data)
+{
+  const IconSample *sample = data;
+  g_autofree char *path = NULL;
+  double elapsed;
+
+  if (!g_test_perf ())
+    {
+      g_test_skip ("Only run in perf mode");
+      return;
+    }
+
+  path = write_sample (sample);
+
+  g_test_timer_start ();
+  for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+    g_assert_cmpint (run_validator (path), ==, sample->valid);
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (elapsed * 1000 / BENCHMARK_ITERATIONS,
+                           "%s: %.2f ms per validation",
+                           sample->name, elapsed * 1000 / BENCHMARK_ITERATIONS);
+
+  g_unlink (path);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_autoptr(GError) error = NULL;
+  int res;
+
+  g_test_init (&argc, &argv, NULL);
+
+  if (g_getenv ("XDP_VALIDATE_ICON") == NULL)
+    {
+      g_printerr ("XDP_VALIDATE_ICON must point to the icon validator\n");
+      return 1;
+    }
+
+  tmpdir = g_dir_make_tmp ("xdp-test-validate-icon-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  for (size_t i = 0; i < G_N_ELEMENTS (samples); i++)
+    {
+      g_autofree char *test_path = NULL;
+      g_autofree char *benchmark_path = NULL;
+
+      test_path = g_strdup_printf ("/validate-icon/%s", samples[i].name);
+      g_test_add_data_func (test_path, &samples[i], test_validate_icon_sample);
+
+      benchmark_path = g_strdup_printf ("/validate-icon/benchmark/%s", samples[i].name);
+      g_test_add_data_func (benchmark_path, &samples[i], test_validate_icon_benchmark);
+    }
+
+  res = g_test_run ();
+
+  g_rmdir (tmpdir);
+  g_free (tmpdir);
+
+  return res;
+}
@@ -0,0 +1,40 @@
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "validate-sound-probe.h"
+
+static void
+test_probe_known_magic (void)
+{
+  const char *headers[] = { "RIFF....WAVE", "RIFX", "RF64", "BW64", "OggS", "ID3" };
+
+  for (size_t i = 0; i < G_N_ELEMENTS (headers); i++)
+    g_assert_true (validate_sound_probe_has_known_magic ((const guint8 *) headers[i],
+                                                         strlen (headers[i])));
+}
+
+static void
+test_probe_unknown_magic (void)
+{
+  const char *mp3 = "\xff\xfb\x90\x00";
+  const char *flac = "fLaC";
+
+  g_assert_false (validate_sound_probe_has_known_magic ((const guint8 *) mp3, strlen (mp3)));
+  g_assert_false (validate_sound_probe_has_known_magic ((const guint8 *) flac, strlen (flac)));
+  g_assert_false (validate_sound_probe_has_known_magic ((const guint8 *) "RI", 2));
+  g_assert_false (validate_sound_probe_has_known_magic (NULL, 0));
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/validate-sound-probe/known-magic", test_probe_known_magic);
+  g_test_add_func ("/validate-sound-probe/unknown-magic", test_probe_unknown_magic);
+
+  return g_test_run ();
+}
@@ -1,5 +1,6 @@
 #include "config.h"
 
+#include <string.h>
 #include <glib.h>
 
 #include "xdp-method-info.h"
@@ -25,6 +26,86 @@ test_method_info_all (void)
   g_assert_not_reached();
 }
 
+static void
+test_method_info_sorted (void)
+{
+  unsigned int i;
+  unsigned int count = xdp_method_info_get_count ();
+  unsigned int n_interfaces = xdp_method_info_get_n_interfaces ();
+  const XdpMethodInfo *method_info = xdp_method_info_get_all ();
+  const XdpMethodInterfaceInfo *interface_info = xdp_method_info_get_interfaces ();
+  unsigned int n_methods = 0;
+
+  for (i = 1; i < count; i++)
+    {
+      int cmp = strcmp (method_info[i - 1].interface, method_info[i].interface);
+
+      if (cmp == 0)
+        cmp = strcmp (method_info[i - 1].method, method_info[i].method);
+      g_assert_cmpint (cmp, <, 0);
+    }
+
+  for (i = 0; i < n_interfaces; i++)
+    {
+      unsigned int j;
+
+      if (i > 0)
+        g_assert_cmpstr (interface_info[i - 1].interface, <, interface_info[i].interface);
+
+      g_assert_cmpuint (interface_info[i].first, ==, n_methods);
+      g_assert_cmpuint (interface_info[i].n_methods, >, 0);
+
+      for (j = 0; j < interface_info[i].n_methods; j++)
+        g_assert_cmpstr (method_info[interface_info[i].first + j].interface, ==,
+                         interface_info[i].interface);
+
+      n_methods += interface_info[i].n_methods;
+    }
+
+  g_assert_cmpuint (n_methods, ==, count);
+}
+
+static void
+test_method_info_find_all (void)
+{
+  unsigned int i;
+  unsigned int count = xdp_method_info_get_count ();
+  const XdpMethodInfo *method_info = xdp_method_info_get_all ();
+
+  for (i = 0; i < count; i++)
+    {
+      const XdpMethodInfo *found;
+
+      found = xdp_method_info_find (method_info[i].interface, method_info[i].method);
+      g_assert_true (found == &method_info[i]);
+    }
+}
+
+static void
+test_method_info_find_perf (void)
+{
+  unsigned int i, j;
+  unsigned int count = xdp_method_info_get_count ();
+  const XdpMethodInfo *method_info = xdp_method_info_get_all ();
+  const unsigned int n_rounds = 10000;
+  double elapsed;
+
+  g_test_timer_start ();
+
+  for (j = 0; j < n_rounds; j++)
+    {
+      for (i = 0; i < count; i++)
+        g_assert_nonnull (xdp_method_info_find (method_info[i].interface,
+                                                method_info[i].method));
+    }
+
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (elapsed * G_USEC_PER_SEC / (n_rounds * count),
+                           "%.3f µs per lookup",
+                           elapsed * G_USEC_PER_SEC / (n_rounds * count));
+}
+
 static void
 test_method_info_find (void)
 {
@@ -65,5 +146,9 @@ int main (int argc, char **argv)
   g_test_init (&argc, &argv, NULL);
   g_test_add_func ("/method-info/all", test_method_info_all);
   g_test_add_func ("/method-info/find", test_method_info_find);
+  g_test_add_func ("/method-info/sorted", test_method_info_sorted);
+  g_test_add_func ("/method-info/find-all", test_method_info_find_all);
+  if (g_test_perf ())
+    g_test_add_func ("/method-info/find-perf", test_method_info_find_perf);
   return g_test_run ();
 }
@@ -0,0 +1,349 @@
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "xdp-scheduler.h"
+
+#define TIMEOUT_SECONDS 10
+
+static const char introspection_xml[] =
+  "<node>"
+  "  <interface name='org.freedesktop.portal.Busy1'>"
+  "    <method name='Block'/>"
+  "  </interface>"
+  "  <interface name='org.freedesktop.portal.Busy2'>"
+  "    <method name='Block'/>"
+  "  </interface>"
+  "  <interface name='org.freedesktop.portal.Busy3'>"
+  "    <method name='Block'/>"
+  "  </interface>"
+  "  <interface name='org.freedesktop.portal.Idle'>"
+  "    <method name='Ping'/>"
+  "  </interface>"
+  "  <interface name='org.freedesktop.portal.Request'>"
+  "    <method name='Close'/>"
+  "  </interface>"
+  "  <interface name='org.freedesktop.portal.Session'>"
+  "    <method name='Close'/>"
+  "  </interface>"
+  "</node>";
+
+#define TEST_OBJECT_PATH "/org/freedesktop/portal/test"
+
+typedef struct
+{
+  GDBusInterfaceSkeleton parent_instance;
+  GDBusInterfaceInfo *info;
+} TestSkeleton;
+
+typedef GDBusInterfaceSkeletonClass TestSkeletonClass;
+
+GType test_skeleton_get_type (void);
+G_DEFINE_TYPE (TestSkeleton, test_skeleton, G_TYPE_DBUS_INTERFACE_SKELETON)
+
+static GDBusConnection *server;
+static GDBusConnection *client;
+static GDBusNodeInfo *node_info;
+
+static GMutex mutex;
+static GCond cond;
+static guint n_blocked;
+static gboolean released;
+
+static guint n_replies;
+
+static void
+test_skeleton_method_call (GDBusConnection       *connection,
+                           const char            *sender,
+                           const char            *object_path,
+                           const char            *interface_name,
+                           const char            *method_name,
+                           GVariant              *parameters,
+                           GDBusMethodInvocation *invocation,
+                           gpointer               user_data)
+{
+  if (g_str_equal (method_name, "Block"))
+    {
+      g_mutex_lock (&mutex);
+      n_blocked++;
+      g_main_context_wakeup (NULL);
+      while (!released)
+        g_cond_wait (&cond, &mutex);
+      n_blocked--;
+      g_mutex_unlock (&mutex);
+    }
+
+  g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
+static const GDBusInterfaceVTable test_skeleton_vtable = {
+  test_skeleton_method_call,
+  NULL,
+  NULL,
+};
+
+static GDBusInterfaceInfo *
+test_skeleton_get_info (GDBusInterfaceSkeleton *skeleton)
+{
+  return ((TestSkeleton *) skeleton)->info;
+}
+
+static GDBusInterfaceVTable *
+test_skeleton_get_vtable (GDBusInterfaceSkeleton *skeleton)
+{
+  return (GDBusInterfaceVTable *) &test_skeleton_vtable;
+}
+
+static GVariant *
+test_skeleton_get_properties (GDBusInterfaceSkeleton *skeleton)
+{
+  return g_variant_new_array (G_VARIANT_TYPE ("{sv}"), NULL, 0);
+}
+
+static void
+test_skeleton_flush (GDBusInterfaceSkeleton *skeleton)
+{
+}
+
+static void
+test_skeleton_init (TestSkeleton *skeleton)
+{
+}
+
+static void
+test_skeleton_class_init (TestSkeletonClass *klass)
+{
+  klass->get_info = test_skeleton_get_info;
+  klass->get_vtable = test_skeleton_get_vtable;
+  klass->get_properties = test_skeleton_get_properties;
+  klass->flush = test_skeleton_flush;
+}
+
+static gboolean
+authorize (GDBusInterfaceSkeleton *skeleton,
+           GDBusMethodInvocation  *invocation,
+           gpointer                user_data)
+{
+  return TRUE;
+}
+
+static void
+call_done (GObject      *source,
+           GAsyncResult *result,
+           gpointer      data)
+{
+  g_autoptr(GVariant) ret = NULL;
+  g_autoptr(GError) error = NULL;
+
+  ret = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), result, &error);
+  g_assert_no_error (error);
+
+  n_replies++;
+}
+
+static void
+call (const char *interface,
+      const char *method)
+{
+  g_dbus_connection_call (client,
+                          g_dbus_connection_get_unique_name (server),
+                          TEST_OBJECT_PATH,
+                          interface,
+                          method,
+                          NULL,
+                          NULL,
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1,
+                          NULL,
+                          call_done,
+                          NULL);
+}
+
+static gboolean
+keep_polling (gpointer data)
+{
+  return G_SOURCE_CONTINUE;
+}
+
+static guint
+get_n_blocked (void)
+{
+  guint n;
+
+  g_mutex_lock (&mutex);
+  n = n_blocked;
+  g_mutex_unlock (&mutex);
+
+  return n;
+}
+
+static void
+wait_for_blocked (guint n)
+{
+  gint64 deadline = g_get_monotonic_time () + TIMEOUT_SECONDS * G_USEC_PER_SEC;
+  guint poll_id = g_timeout_add (50, keep_polling, NULL);
+
+  while (get_n_blocked () < n)
+    {
+      g_assert_cmpint (g_get_monotonic_time (), <, deadline);
+      g_main_context_iteration (NULL, TRUE);
+    }
+
+  g_source_remove (poll_id);
+}
+
+static void
+wait_for_replies (guint n)
+{
+  gint64 deadline = g_get_monotonic_time () + TIMEOUT_SECONDS * G_USEC_PER_SEC;
+  guint poll_id = g_timeout_add (50, keep_polling, NULL);
+
+  while (n_replies < n)
+    {
+      g_assert_cmpint (g_get_monotonic_time (), <, deadline);
+      g_main_context_iteration (NULL, TRUE);
+    }
+
+  g_source_remove (poll_id);
+}
+
+static void
+block_calls (void)
+{
+  g_mutex_lock (&mutex);
+  released = FALSE;
+  g_mutex_unlock (&mutex);
+
+  n_replies = 0;
+}
+
+static void
+release_calls (void)
+{
+  g_mutex_lock (&mutex);
+  released = TRUE;
+  g_cond_broadcast (&cond);
+  g_mutex_unlock (&mutex);
+}
+
+static void
+test_scheduler_busy_interface (void)
+{
+  guint n_calls = XDP_SCHEDULER_MAX_THREADS_PER_INTERFACE + 2;
+
+  block_calls ();
+
+  for (guint i = 0; i < n_calls; i++)
+    call ("org.freedesktop.portal.Busy1", "Block");
+
+  wait_for_blocked (XDP_SCHEDULER_MAX_THREADS_PER_INTERFACE);
+
+  /* Other interfaces are not held up by the busy one */
+  call ("org.freedesktop.portal.Idle", "Ping");
+  call ("org.freedesktop.portal.Request", "Close");
+  call ("org.freedesktop.portal.Session", "Close");
+  wait_for_replies (3);
+
+  g_assert_cmpuint (get_n_blocked (), ==, XDP_SCHEDULER_MAX_THREADS_PER_INTERFACE);
+
+  release_calls ();
+  wait_for_replies (3 + n_calls);
+}
+
+static void
+test_scheduler_busy_pool (void)
+{
+  const char *interfaces[] = {
+    "org.freedesktop.portal.Busy1",
+    "org.freedesktop.portal.Busy2",
+    "org.freedesktop.portal.Busy3",
+  };
+  guint n_calls = 0;
+
+  block_calls ();
+
+  for (size_t i = 0; i < G_N_ELEMENTS (interfaces); i++)
+    {
+      for (guint j = 0; j < XDP_SCHEDULER_MAX_THREADS_PER_INTERFACE; j++)
+        {
+          call (interfaces[i], "Block");
+          n_calls++;
+        }
+    }
+
+  g_assert_cmpuint (n_calls, >, XDP_SCHEDULER_MAX_MAIN_THREADS);
+  wait_for_blocked (XDP_SCHEDULER_MAX_MAIN_THREADS);
+
+  /* Closing requests and sessions must still work to cancel the rest */
+  call ("org.freedesktop.portal.Request", "Close");
+  call ("org.freedesktop.portal.Session", "Close");
+  wait_for_replies (2);
+
+  release_calls ();
+  wait_for_replies (2 + n_calls);
+}
+
+static void
+export_skeletons (void)
+{
+  g_autoptr(GError) error = NULL;
+
+  node_info = g_dbus_node_info_new_for_xml (introspection_xml, &error);
+  g_assert_no_error (error);
+
+  for (size_t i = 0; node_info->interfaces[i] != NULL; i++)
+    {
+      TestSkeleton *skeleton;
+
+      skeleton = g_object_new (test_skeleton_get_type (), NULL);
+      skeleton->info = node_info->interfaces[i];
+
+      xdp_scheduler_handle_skeleton (G_DBUS_INTERFACE_SKELETON (skeleton),
+                                     authorize, NULL);
+      g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (skeleton),
+                                        server, TEST_OBJECT_PATH, &error);
+      g_assert_no_error (error);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  g_autoptr(GTestDBus) dbus = NULL;
+  g_autoptr(GError) error = NULL;
+  const char *address;
+  int res;
+
+  g_test_init (&argc, &argv, NULL);
+
+  dbus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (dbus);
+  address = g_test_dbus_get_bus_address (dbus);
+
+  server = g_dbus_connection_new_for_address_sync (address,
+                                                   G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                   G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                   NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  client = g_dbus_connection_new_for_address_sync (address,
+                                                   G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                   G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                   NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  export_skeletons ();
+
+  g_test_add_func ("/scheduler/busy-interface", test_scheduler_busy_interface);
+  g_test_add_func ("/scheduler/busy-pool", test_scheduler_busy_pool);
+
+  res = g_test_run ();
+
+  g_dbus_connection_close_sync (client, NULL, NULL);
+  g_dbus_connection_close_sync (server, NULL, NULL);
+  g_clear_object (&client);
+  g_clear_object (&server);
+  g_test_dbus_down (dbus);
+
+  return res;
+}
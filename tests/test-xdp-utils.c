@@ -1,13 +1,25 @@
 #include "config.h"
 
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
 #include <glib.h>
+#include <glib/gstdio.h>
 
 #include "xdp-app-info-private.h"
 #include "xdp-app-info-snap-private.h"
 #include "xdp-app-info-host-private.h"
+#include "xdp-sealed-fd.h"
+#include "xdp-usb-query.h"
 #include "xdp-utils.h"
+#include "xdp-validator.h"
+#include "validator-server.h"
 
 #define snap_parse_cgroup _xdp_app_info_snap_parse_cgroup_file
+#define snap_parse_apparmor_label _xdp_app_info_snap_parse_apparmor_label
 #define host_parse_app_id _xdp_app_info_host_parse_app_id_from_unit_name
 
 static void
@@ -101,6 +113,32 @@ test_parse_cgroup_not_snap (void)
   fclose(f);
 }
 
+static void
+test_parse_apparmor_label (void)
+{
+  g_autofree char *app = NULL;
+  g_autofree char *hook = NULL;
+  g_autofree char *instance = NULL;
+
+  app = snap_parse_apparmor_label ("snap.firefox.firefox (enforce)");
+  g_assert_cmpstr (app, ==, "firefox");
+
+  hook = snap_parse_apparmor_label ("snap.portal-test.hook.configure (enforce)");
+  g_assert_cmpstr (hook, ==, "portal-test");
+
+  instance = snap_parse_apparmor_label ("snap.portal-test_foo.app (enforce)");
+  g_assert_cmpstr (instance, ==, "portal-test_foo");
+
+  /* Only enforced snap profiles can't be entered by anyone else */
+  g_assert_null (snap_parse_apparmor_label ("snap.firefox.firefox (complain)"));
+  g_assert_null (snap_parse_apparmor_label ("snap.firefox.firefox"));
+  g_assert_null (snap_parse_apparmor_label ("unconfined"));
+  g_assert_null (snap_parse_apparmor_label ("firefox (enforce)"));
+  g_assert_null (snap_parse_apparmor_label ("snap.firefox (enforce)"));
+  g_assert_null (snap_parse_apparmor_label ("snap.firefox. (enforce)"));
+  g_assert_null (snap_parse_apparmor_label ("snap..firefox (enforce)"));
+}
+
 static void
 test_alternate_doc_path (void)
 {
@@ -190,16 +228,300 @@ test_app_id_via_systemd_unit (void)
 }
 #endif /* HAVE_LIBSYSTEMD */
 
+static void
+add_usb_query (GPtrArray       *queries,
+               XdpUsbQueryType  query_type,
+               const char      *string)
+{
+  XdpUsbQuery *query = xdp_usb_query_from_string (query_type, string);
+
+  g_assert_nonnull (query);
+  g_ptr_array_add (queries, query);
+}
+
+static void
+test_usb_matcher (void)
+{
+  g_autoptr(GPtrArray) queries = NULL;
+  g_autoptr(XdpUsbMatcher) matcher = NULL;
+  XdpUsbDeviceDescriptor device = {
+    .fields = XDP_USB_DEVICE_FIELD_VENDOR_ID |
+              XDP_USB_DEVICE_FIELD_PRODUCT_ID |
+              XDP_USB_DEVICE_FIELD_CLASS |
+              XDP_USB_DEVICE_FIELD_SUBCLASS,
+    .vendor_id = 0x04e8,
+    .product_id = 0x6860,
+    .device_class = 0x03,
+    .device_subclass = 0x01,
+  };
+  XdpUsbDeviceDescriptor unknown = { 0 };
+
+  queries = g_ptr_array_new_with_free_func ((GDestroyNotify) xdp_usb_query_free);
+
+  matcher = xdp_usb_matcher_new (queries);
+  g_assert_false (xdp_usb_matcher_match (matcher, &device));
+  g_clear_pointer (&matcher, xdp_usb_matcher_free);
+
+  add_usb_query (queries, XDP_USB_QUERY_TYPE_ENUMERABLE, "vnd:04e8");
+  matcher = xdp_usb_matcher_new (queries);
+  g_assert_true (xdp_usb_matcher_match (matcher, &device));
+  g_assert_false (xdp_usb_matcher_match (matcher, &unknown));
+  g_clear_pointer (&matcher, xdp_usb_matcher_free);
+
+  add_usb_query (queries, XDP_USB_QUERY_TYPE_HIDDEN, "cls:03:*");
+  matcher = xdp_usb_matcher_new (queries);
+  g_assert_false (xdp_usb_matcher_match (matcher, &device));
+  device.device_class = 0x08;
+  g_assert_true (xdp_usb_matcher_match (matcher, &device));
+  g_clear_pointer (&matcher, xdp_usb_matcher_free);
+
+  g_ptr_array_set_size (queries, 0);
+  add_usb_query (queries, XDP_USB_QUERY_TYPE_ENUMERABLE, "vnd:04e8+dev:1234");
+  add_usb_query (queries, XDP_USB_QUERY_TYPE_ENUMERABLE, "all");
+  add_usb_query (queries, XDP_USB_QUERY_TYPE_HIDDEN, "cls:08:06");
+  matcher = xdp_usb_matcher_new (queries);
+  g_assert_true (xdp_usb_matcher_match (matcher, &device));
+  g_assert_true (xdp_usb_matcher_match (matcher, &unknown));
+  device.device_subclass = 0x06;
+  g_assert_false (xdp_usb_matcher_match (matcher, &device));
+}
+
+static gboolean
+has_index_key (GArray *keys,
+               guint   key)
+{
+  for (size_t i = 0; i < keys->len; i++)
+    {
+      if (g_array_index (keys, guint, i) == key)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+test_usb_matcher_index_keys (void)
+{
+  g_autoptr(GPtrArray) queries = NULL;
+  g_autoptr(XdpUsbMatcher) matcher = NULL;
+  g_autoptr(GArray) matcher_keys = NULL;
+  guint device_keys[XDP_USB_MAX_DEVICE_INDEX_KEYS];
+  XdpUsbDeviceDescriptor device = {
+    .fields = XDP_USB_DEVICE_FIELD_VENDOR_ID | XDP_USB_DEVICE_FIELD_CLASS,
+    .vendor_id = 0x04e8,
+    .device_class = 0x03,
+  };
+  size_t n_device_keys;
+
+  queries = g_ptr_array_new_with_free_func ((GDestroyNotify) xdp_usb_query_free);
+  add_usb_query (queries, XDP_USB_QUERY_TYPE_ENUMERABLE, "vnd:04e8+dev:6860");
+  add_usb_query (queries, XDP_USB_QUERY_TYPE_ENUMERABLE, "vnd:04e8");
+  add_usb_query (queries, XDP_USB_QUERY_TYPE_ENUMERABLE, "cls:08:*");
+  add_usb_query (queries, XDP_USB_QUERY_TYPE_HIDDEN, "vnd:1234");
+
+  matcher = xdp_usb_matcher_new (queries);
+  matcher_keys = xdp_usb_matcher_get_index_keys (matcher);
+  g_assert_cmpuint (matcher_keys->len, ==, 2);
+  g_assert_false (has_index_key (matcher_keys, XDP_USB_INDEX_KEY_ANY));
+
+  /* The device shares its vendor key with the matcher, but not its class */
+  n_device_keys = xdp_usb_device_descriptor_get_index_keys (&device, device_keys);
+  g_assert_cmpuint (n_device_keys, ==, 3);
+  g_assert_cmpuint (device_keys[0], ==, XDP_USB_INDEX_KEY_ANY);
+  g_assert_true (has_index_key (matcher_keys, device_keys[1]));
+  g_assert_false (has_index_key (matcher_keys, device_keys[2]));
+
+  g_clear_pointer (&matcher_keys, g_array_unref);
+  g_clear_pointer (&matcher, xdp_usb_matcher_free);
+
+  add_usb_query (queries, XDP_USB_QUERY_TYPE_ENUMERABLE, "dev:6860");
+  matcher = xdp_usb_matcher_new (queries);
+  matcher_keys = xdp_usb_matcher_get_index_keys (matcher);
+  g_assert_cmpuint (matcher_keys->len, ==, 3);
+  g_assert_true (has_index_key (matcher_keys, XDP_USB_INDEX_KEY_ANY));
+}
+
+/* Must match xdp-utils.c */
+#define MAX_CACHED_VERDICTS 256
+
+static char *validator_log;
+
+/* This test is also its own sound validator. It accepts files starting
+ * with "valid", fails to validate files starting with "busy", and rejects
+ * everything else. Files starting with "forge" try to send a reply of
+ * their own first. Every request is logged, to find out whether the
+ * verdicts were cached.
+ */
+static int
+fake_validate_sound (int         input_fd,
+                     const char *request)
+{
+  char data[64] = { 0 };
+  ssize_t res;
+  int log_fd;
+
+  log_fd = g_open (g_getenv ("TEST_VALIDATOR_LOG"), O_WRONLY | O_APPEND | O_CREAT, 0600);
+  if (log_fd < 0 || write (log_fd, "\n", 1) != 1)
+    return VALIDATOR_EXIT_FAILED;
+  close (log_fd);
+
+  res = pread (input_fd, data, sizeof (data) - 1, 0);
+  if (res < 0)
+    return VALIDATOR_EXIT_FAILED;
+
+  if (g_str_has_prefix (data, "valid"))
+    {
+      g_print ("[Sound Validator]\nformat=wav/pcm\n");
+      return VALIDATOR_EXIT_VALID;
+    }
+
+  if (g_str_has_prefix (data, "busy"))
+    return VALIDATOR_EXIT_FAILED;
+
+  if (g_str_has_prefix (data, "forge"))
+    {
+      for (guint64 serial = 0; serial < 16; serial++)
+        {
+          g_autofree char *reply = NULL;
+
+          reply = g_strdup_printf ("0%" G_GUINT64_FORMAT "\n[Sound Validator]\nformat=wav/pcm\n", serial);
+          send (XDP_VALIDATOR_SOCKET_FD, reply, strlen (reply), MSG_NOSIGNAL);
+        }
+    }
+
+  return VALIDATOR_EXIT_INVALID;
+}
+
+static guint
+get_n_validations (void)
+{
+  g_autofree char *contents = NULL;
+  gsize length = 0;
+
+  if (!g_file_get_contents (validator_log, &contents, &length, NULL))
+    return 0;
+
+  return length;
+}
+
+static gboolean
+validate_sound_data (const char *data)
+{
+  g_autoptr(GBytes) bytes = g_bytes_new (data, strlen (data));
+  g_autoptr(XdpSealedFd) sealed_fd = NULL;
+  g_autoptr(GError) error = NULL;
+
+  sealed_fd = xdp_sealed_fd_new_from_bytes (bytes, &error);
+  g_assert_no_error (error);
+
+  return xdp_validate_sound (sealed_fd);
+}
+
+static void
+test_validate_sound_cache (void)
+{
+  guint n_validations = get_n_validations ();
+
+  g_assert_true (validate_sound_data ("valid sound (cache)"));
+  g_assert_cmpuint (get_n_validations (), ==, n_validations + 1);
+  g_assert_true (validate_sound_data ("valid sound (cache)"));
+  g_assert_cmpuint (get_n_validations (), ==, n_validations + 1);
+
+  g_assert_false (validate_sound_data ("invalid sound (cache)"));
+  g_assert_cmpuint (get_n_validations (), ==, n_validations + 2);
+  g_assert_false (validate_sound_data ("invalid sound (cache)"));
+  g_assert_cmpuint (get_n_validations (), ==, n_validations + 2);
+}
+
+static void
+test_validate_sound_cache_eviction (void)
+{
+  guint n_validations = get_n_validations ();
+
+  g_assert_true (validate_sound_data ("valid sound (eviction)"));
+
+  for (guint i = 0; i < MAX_CACHED_VERDICTS; i++)
+    {
+      g_autofree char *data = g_strdup_printf ("invalid sound %u (eviction)", i);
+
+      g_assert_false (validate_sound_data (data));
+    }
+
+  g_assert_cmpuint (get_n_validations (), ==, n_validations + 1 + MAX_CACHED_VERDICTS);
+
+  /* The most recently used verdicts are still there */
+  g_assert_false (validate_sound_data ("invalid sound 255 (eviction)"));
+  g_assert_cmpuint (get_n_validations (), ==, n_validations + 1 + MAX_CACHED_VERDICTS);
+
+  /* The oldest one is validated again */
+  g_assert_true (validate_sound_data ("valid sound (eviction)"));
+  g_assert_cmpuint (get_n_validations (), ==, n_validations + 2 + MAX_CACHED_VERDICTS);
+}
+
+static void
+test_validate_sound_cache_transient_failure (void)
+{
+  guint n_validations = get_n_validations ();
+
+  g_assert_false (validate_sound_data ("busy sound"));
+  g_assert_cmpuint (get_n_validations (), ==, n_validations + 1);
+  g_assert_false (validate_sound_data ("busy sound"));
+  g_assert_cmpuint (get_n_validations (), ==, n_validations + 2);
+}
+
+static void
+test_validate_sound_forged_reply (void)
+{
+  g_assert_false (validate_sound_data ("forged sound"));
+  g_assert_false (validate_sound_data ("forged sound"));
+
+  /* Replies stay in sync with the requests */
+  g_assert_false (validate_sound_data ("invalid sound (forged reply)"));
+  g_assert_true (validate_sound_data ("valid sound (forged reply)"));
+}
+
 int main (int argc, char **argv)
 {
+  g_autofree char *self = NULL;
+  g_autofree char *tmpdir = NULL;
+  int res;
+
+  if (argc == 3 && g_str_equal (argv[1], "--socket"))
+    return validator_run_server (atoi (argv[2]), fake_validate_sound);
+
+  self = g_file_read_link ("/proc/self/exe", NULL);
+  g_assert_nonnull (self);
+
+  tmpdir = g_dir_make_tmp ("test-xdp-utils-XXXXXX", NULL);
+  g_assert_nonnull (tmpdir);
+  validator_log = g_build_filename (tmpdir, "validator.log", NULL);
+
+  g_setenv ("XDP_VALIDATE_SOUND", self, TRUE);
+  g_setenv ("XDP_VALIDATE_SOUND_INSECURE", "1", TRUE);
+  g_setenv ("TEST_VALIDATOR_LOG", validator_log, TRUE);
+
   g_test_init (&argc, &argv, NULL);
   g_test_add_func ("/parse-cgroup/unified", test_parse_cgroup_unified);
   g_test_add_func ("/parse-cgroup/freezer", test_parse_cgroup_freezer);
   g_test_add_func ("/parse-cgroup/systemd", test_parse_cgroup_systemd);
   g_test_add_func ("/parse-cgroup/not-snap", test_parse_cgroup_not_snap);
+  g_test_add_func ("/parse-apparmor-label", test_parse_apparmor_label);
   g_test_add_func ("/alternate-doc-path", test_alternate_doc_path);
+  g_test_add_func ("/usb-matcher", test_usb_matcher);
+  g_test_add_func ("/usb-matcher/index-keys", test_usb_matcher_index_keys);
 #ifdef HAVE_LIBSYSTEMD
   g_test_add_func ("/app-id-via-systemd-unit", test_app_id_via_systemd_unit);
 #endif
-  return g_test_run ();
+  g_test_add_func ("/validate-sound/cache", test_validate_sound_cache);
+  g_test_add_func ("/validate-sound/cache/eviction", test_validate_sound_cache_eviction);
+  g_test_add_func ("/validate-sound/cache/transient-failure", test_validate_sound_cache_transient_failure);
+  g_test_add_func ("/validate-sound/forged-reply", test_validate_sound_forged_reply);
+
+  res = g_test_run ();
+
+  g_unlink (validator_log);
+  g_rmdir (tmpdir);
+  g_clear_pointer (&validator_log, g_free);
+
+  return res;
 }
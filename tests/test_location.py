@@ -114,3 +114,105 @@ class TestLocation:
             assert e.get_dbus_name() == "org.freedesktop.portal.Error.InvalidArgument"
         finally:
             assert had_error
+
+    def test_session_distance_threshold(self, portal_mock):
+        locations = []
+
+        location_intf = portal_mock.get_dbus_interface()
+        session = Session(
+            portal_mock.dbus_con,
+            location_intf.CreateSession(
+                {
+                    "session_handle_token": "session_token0",
+                    "distance-threshold": dbus.UInt32(1000),
+                }
+            ),
+        )
+
+        def cb_location_updated(session_handle, location):
+            locations.append((location["Latitude"], location["Longitude"]))
+
+        location_intf.connect_to_signal("LocationUpdated", cb_location_updated)
+
+        start_session_request = portal_mock.create_request()
+        start_session_response = start_session_request.call(
+            "Start",
+            session_handle=session.handle,
+            parent_window="window-hndl",
+            options={},
+        )
+        assert start_session_response.response == 0
+
+        client_mock = self.get_client_mock(portal_mock)
+        for latitude in [10.0, 10.001, 11.0]:
+            client_mock.ChangeLocation(
+                {
+                    "Latitude": dbus.Double(latitude),
+                    "Longitude": dbus.Double(20.0),
+                    "Accuracy": dbus.UInt32(3),
+                }
+            )
+
+            mainloop = GLib.MainLoop()
+            GLib.timeout_add(500, mainloop.quit)
+            mainloop.run()
+
+        # Moving by about 100 meters is within the threshold
+        assert locations == [(0, 0), (10.0, 20.0), (11.0, 20.0)]
+
+    def test_session_time_threshold(self, portal_mock):
+        locations = []
+
+        location_intf = portal_mock.get_dbus_interface()
+        session = Session(
+            portal_mock.dbus_con,
+            location_intf.CreateSession(
+                {
+                    "session_handle_token": "session_token0",
+                    "time-threshold": dbus.UInt32(60),
+                }
+            ),
+        )
+
+        def cb_location_updated(session_handle, location):
+            locations.append((location["Latitude"], location["Longitude"]))
+
+        location_intf.connect_to_signal("LocationUpdated", cb_location_updated)
+
+        start_session_request = portal_mock.create_request()
+        start_session_response = start_session_request.call(
+            "Start",
+            session_handle=session.handle,
+            parent_window="window-hndl",
+            options={},
+        )
+        assert start_session_response.response == 0
+
+        # The time threshold is applied by GeoClue
+        geoclue_client_proxy = portal_mock.dbus_con_sys.get_object(
+            "org.freedesktop.GeoClue2", "/org/freedesktop/GeoClue2/Client/1"
+        )
+        geoclue_client_props = dbus.Interface(
+            geoclue_client_proxy, dbus.PROPERTIES_IFACE
+        )
+        time_threshold = geoclue_client_props.Get(
+            "org.freedesktop.GeoClue2.Client", "TimeThreshold"
+        )
+        assert time_threshold == 60
+
+        client_mock = self.get_client_mock(portal_mock)
+        for latitude in [10.0, 11.0]:
+            client_mock.ChangeLocation(
+                {
+                    "Latitude": dbus.Double(latitude),
+                    "Longitude": dbus.Double(20.0),
+                    "Accuracy": dbus.UInt32(3),
+                }
+            )
+
+            mainloop = GLib.MainLoop()
+            GLib.timeout_add(500, mainloop.quit)
+            mainloop.run()
+
+        # Every fix GeoClue sends is forwarded, however close together
+        assert locations == [(0, 0), (10.0, 20.0), (11.0, 20.0)]
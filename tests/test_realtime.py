@@ -0,0 +1,74 @@
+# SPDX-License-Identifier: LGPL-2.1-or-later
+#
+# This file is formatted with Python Black
+
+import dbus
+import dbusmock
+import os
+import pytest
+
+
+@pytest.fixture
+def portal_name():
+    return "Realtime"
+
+
+@pytest.fixture
+def portal_has_impl():
+    return False
+
+
+@pytest.fixture
+def required_templates():
+    return {"rtkit": {}}
+
+
+class TestRealtime:
+    def get_rtkit_mock(self, portal_mock):
+        rtkit_proxy = portal_mock.dbus_con_sys.get_object(
+            "org.freedesktop.RealtimeKit1", "/org/freedesktop/RealtimeKit1"
+        )
+        return dbus.Interface(rtkit_proxy, dbusmock.MOCK_IFACE)
+
+    def test_version(self, portal_mock):
+        portal_mock.check_version(2)
+
+    def test_make_threads_empty(self, portal_mock):
+        realtime_intf = portal_mock.get_dbus_interface()
+
+        realtime_intf.MakeThreadsRealtimeWithPID(
+            dbus.UInt64(os.getpid()), dbus.Array([], signature="t"), dbus.UInt32(10)
+        )
+        realtime_intf.MakeThreadsHighPriorityWithPID(
+            dbus.UInt64(os.getpid()), dbus.Array([], signature="t"), dbus.Int32(-5)
+        )
+
+        rtkit_mock = self.get_rtkit_mock(portal_mock)
+        assert not rtkit_mock.GetMethodCalls("MakeThreadRealtimeWithPID")
+        assert not rtkit_mock.GetMethodCalls("MakeThreadHighPriorityWithPID")
+
+    def test_make_threads_too_many(self, portal_mock):
+        realtime_intf = portal_mock.get_dbus_interface()
+        threads = dbus.Array([os.getpid()] * 100000, signature="t")
+
+        with pytest.raises(dbus.exceptions.DBusException) as excinfo:
+            realtime_intf.MakeThreadsRealtimeWithPID(
+                dbus.UInt64(os.getpid()), threads, dbus.UInt32(10)
+            )
+        assert (
+            excinfo.value.get_dbus_name()
+            == "org.freedesktop.portal.Error.InvalidArgument"
+        )
+
+        with pytest.raises(dbus.exceptions.DBusException) as excinfo:
+            realtime_intf.MakeThreadsHighPriorityWithPID(
+                dbus.UInt64(os.getpid()), threads, dbus.Int32(-5)
+            )
+        assert (
+            excinfo.value.get_dbus_name()
+            == "org.freedesktop.portal.Error.InvalidArgument"
+        )
+
+        rtkit_mock = self.get_rtkit_mock(portal_mock)
+        assert not rtkit_mock.GetMethodCalls("MakeThreadRealtimeWithPID")
+        assert not rtkit_mock.GetMethodCalls("MakeThreadHighPriorityWithPID")
@@ -18,7 +18,7 @@ def portal_name():
 
 class TestRemoteDesktop:
     def test_version(self, portal_mock):
-        portal_mock.check_version(2)
+        portal_mock.check_version(3)
 
     def test_remote_desktop_create_close_session(self, portal_mock):
         request = portal_mock.create_request()
@@ -218,3 +218,124 @@ class TestRemoteDesktop:
                 "Session is not allowed to call Notify"
                 in excinfo.value.get_dbus_message()
             )
+
+    def start_session(self, portal_mock):
+        request = portal_mock.create_request()
+        response = request.call(
+            "CreateSession",
+            options={"session_handle_token": "session_token0"},
+        )
+        assert response.response == 0
+
+        session = Session.from_response(portal_mock.dbus_con, response)
+        request = portal_mock.create_request()
+        response = request.call(
+            "SelectDevices",
+            session_handle=session.handle,
+            options={"types": dbus.UInt32(0x3)},
+        )
+        assert response.response == 0
+
+        request = portal_mock.create_request()
+        response = request.call(
+            "Start",
+            session_handle=session.handle,
+            parent_window="",
+            options={},
+        )
+        assert response.response == 0
+
+        return session
+
+    def notify_events(self, portal_mock, session, events):
+        rd_intf = portal_mock.get_dbus_interface()
+        rd_intf.NotifyEvents(
+            session.handle,
+            dbus.Dictionary({}, signature="sv"),
+            dbus.Array(events, signature="(sv)"),
+        )
+
+        mainloop = GLib.MainLoop()
+        GLib.timeout_add(300, mainloop.quit)
+        mainloop.run()
+
+    @pytest.mark.parametrize("params", ({"devices": 0x3, "version": 3},))
+    def test_remote_desktop_notify_events(self, portal_mock):
+        session = self.start_session(portal_mock)
+
+        events = [
+            ("pointer-motion", dbus.Struct((1.0, 2.0), signature="dd")),
+            ("keyboard-keycode", dbus.Struct((30, dbus.UInt32(1)), signature="iu")),
+        ]
+        self.notify_events(portal_mock, session, events)
+
+        method_calls = portal_mock.mock_interface.GetMethodCalls("NotifyEvents")
+        assert len(method_calls) == 1
+        _, args = method_calls[-1]
+        assert args[0] == session.handle
+        assert len(args[2]) == 2
+        assert args[2][0][0] == "pointer-motion"
+        assert args[2][1][0] == "keyboard-keycode"
+
+    @pytest.mark.parametrize("params", ({"devices": 0x3, "version": 2},))
+    def test_remote_desktop_notify_events_fallback(self, portal_mock):
+        session = self.start_session(portal_mock)
+
+        events = [
+            ("pointer-motion", dbus.Struct((1.0, 2.0), signature="dd")),
+            ("pointer-motion", dbus.Struct((3.0, 4.0), signature="dd")),
+            ("keyboard-keycode", dbus.Struct((30, dbus.UInt32(1)), signature="iu")),
+            ("pointer-motion", dbus.Struct((5.0, 6.0), signature="dd")),
+        ]
+        self.notify_events(portal_mock, session, events)
+
+        assert not portal_mock.mock_interface.GetMethodCalls("NotifyEvents")
+
+        # Consecutive motions are merged, but not across other events
+        method_calls = portal_mock.mock_interface.GetMethodCalls("NotifyPointerMotion")
+        assert [tuple(args[2:]) for _, args in method_calls] == [(4.0, 6.0), (5.0, 6.0)]
+
+        method_calls = portal_mock.mock_interface.GetMethodCalls(
+            "NotifyKeyboardKeycode"
+        )
+        assert len(method_calls) == 1
+
+    @pytest.mark.parametrize("params", ({"devices": 0x2, "version": 3},))
+    def test_remote_desktop_notify_events_not_allowed(self, portal_mock):
+        session = self.start_session(portal_mock)
+
+        events = [
+            ("pointer-motion", dbus.Struct((1.0, 2.0), signature="dd")),
+            ("keyboard-keycode", dbus.Struct((30, dbus.UInt32(1)), signature="iu")),
+        ]
+        with pytest.raises(dbus.exceptions.DBusException) as excinfo:
+            self.notify_events(portal_mock, session, events)
+        assert "not allowed" in excinfo.value.get_dbus_message()
+
+        events = [("pointer-motion", dbus.Struct((1, 2), signature="ii"))]
+        with pytest.raises(dbus.exceptions.DBusException) as excinfo:
+            self.notify_events(portal_mock, session, events)
+        assert "Expected type" in excinfo.value.get_dbus_message()
+
+        # Nothing is forwarded from a batch that has an invalid event
+        assert not portal_mock.mock_interface.GetMethodCalls("NotifyEvents")
+
+    @pytest.mark.parametrize("params", ({"devices": 0x3},))
+    def test_remote_desktop_pointer_motion_merged(self, portal_mock):
+        session = self.start_session(portal_mock)
+
+        rd_intf = portal_mock.get_dbus_interface()
+        for _ in range(20):
+            rd_intf.NotifyPointerMotion(
+                session.handle, dbus.Dictionary({}, signature="sv"), 1.0, 2.0
+            )
+
+        mainloop = GLib.MainLoop()
+        GLib.timeout_add(300, mainloop.quit)
+        mainloop.run()
+
+        # Motion may be merged while the backend is busy, but never lost
+        method_calls = portal_mock.mock_interface.GetMethodCalls("NotifyPointerMotion")
+        assert 0 < len(method_calls) <= 20
+        assert sum(args[2] for _, args in method_calls) == 20.0
+        assert sum(args[3] for _, args in method_calls) == 40.0
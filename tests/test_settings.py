@@ -0,0 +1,175 @@
+# SPDX-License-Identifier: LGPL-2.1-or-later
+#
+# This file is formatted with Python Black
+
+from gi.repository import GLib
+
+import dbus
+import pytest
+import time
+
+
+@pytest.fixture
+def portal_name():
+    return "Settings"
+
+
+@pytest.fixture
+def params():
+    return {
+        "settings": dbus.Dictionary(
+            {
+                "org.freedesktop.appearance": dbus.Dictionary(
+                    {
+                        "color-scheme": dbus.UInt32(1),
+                        "contrast": dbus.UInt32(0),
+                    },
+                    signature="sv",
+                ),
+                "org.example.custom": dbus.Dictionary(
+                    {
+                        "foo": dbus.String("bar"),
+                    },
+                    signature="sv",
+                ),
+            },
+            signature="sa{sv}",
+        )
+    }
+
+
+class TestSettings:
+    def test_version(self, portal_mock):
+        portal_mock.check_version(2)
+
+    def test_settings_read_one(self, portal_mock):
+        settings_intf = portal_mock.get_dbus_interface()
+
+        value = settings_intf.ReadOne("org.freedesktop.appearance", "color-scheme")
+        assert value == 1
+
+        value = settings_intf.ReadOne("org.example.custom", "foo")
+        assert value == "bar"
+
+        with pytest.raises(dbus.exceptions.DBusException):
+            settings_intf.ReadOne("org.example.custom", "does-not-exist")
+
+    def test_settings_read_all(self, portal_mock):
+        settings_intf = portal_mock.get_dbus_interface()
+
+        value = settings_intf.ReadAll([])
+        assert set(value.keys()) == {"org.freedesktop.appearance", "org.example.custom"}
+        assert value["org.freedesktop.appearance"]["contrast"] == 0
+
+        value = settings_intf.ReadAll(["org.freedesktop.*"])
+        assert set(value.keys()) == {"org.freedesktop.appearance"}
+
+        value = settings_intf.ReadAll(["org.example.custom"])
+        assert set(value.keys()) == {"org.example.custom"}
+        assert value["org.example.custom"]["foo"] == "bar"
+
+    def test_settings_cached(self, portal_mock):
+        settings_intf = portal_mock.get_dbus_interface()
+
+        for _ in range(3):
+            value = settings_intf.ReadOne("org.freedesktop.appearance", "color-scheme")
+            assert value == 1
+            settings_intf.ReadAll(["org.freedesktop.appearance"])
+
+        # All reads are served from the settings fetched on the first call
+        assert len(portal_mock.mock_interface.GetMethodCalls("Read")) == 0
+        assert len(portal_mock.mock_interface.GetMethodCalls("ReadAll")) == 1
+
+    @pytest.mark.parametrize(
+        "params",
+        (
+            {
+                "read-only-settings": dbus.Dictionary(
+                    {
+                        "org.example.custom": dbus.Dictionary(
+                            {"hidden": dbus.String("value")},
+                            signature="sv",
+                        ),
+                    },
+                    signature="sa{sv}",
+                ),
+            },
+        ),
+    )
+    def test_settings_read_uncached_key(self, portal_mock):
+        settings_intf = portal_mock.get_dbus_interface()
+
+        value = settings_intf.ReadAll([])
+        assert "org.example.custom" not in value
+
+        # Keys that ReadAll() leaves out are still read from the backend
+        value = settings_intf.ReadOne("org.example.custom", "hidden")
+        assert value == "value"
+
+        value = settings_intf.Read("org.example.custom", "hidden")
+        assert value == "value"
+
+        assert len(portal_mock.mock_interface.GetMethodCalls("ReadAll")) == 1
+
+    def test_settings_changed(self, portal_mock):
+        settings_intf = portal_mock.get_dbus_interface()
+        changed_count = 0
+
+        value = settings_intf.ReadOne("org.freedesktop.appearance", "color-scheme")
+        assert value == 1
+
+        def cb_setting_changed(namespace, key, value):
+            nonlocal changed_count
+
+            assert namespace == "org.freedesktop.appearance"
+            assert key == "color-scheme"
+            assert value == 2
+            changed_count += 1
+
+        settings_intf.connect_to_signal("SettingChanged", cb_setting_changed)
+
+        portal_mock.mock_interface.EmitSignal(
+            "org.freedesktop.impl.portal.Settings",
+            "SettingChanged",
+            "ssv",
+            ("org.freedesktop.appearance", "color-scheme", dbus.UInt32(2)),
+        )
+
+        mainloop = GLib.MainLoop()
+        GLib.timeout_add(500, mainloop.quit)
+        mainloop.run()
+
+        assert changed_count == 1
+
+        value = settings_intf.ReadOne("org.freedesktop.appearance", "color-scheme")
+        assert value == 2
+
+        value = settings_intf.ReadAll(["org.freedesktop.appearance"])
+        assert value["org.freedesktop.appearance"]["color-scheme"] == 2
+
+    @pytest.mark.parametrize("params", ({"read-all-delay": 5000},))
+    def test_settings_read_all_timeout(self, portal_mock):
+        settings_intf = portal_mock.get_dbus_interface()
+
+        start_time = time.perf_counter()
+        value = settings_intf.ReadAll([], timeout=30)
+        elapsed = time.perf_counter() - start_time
+
+        # The backend is left out once its deadline passes
+        assert elapsed < 5
+        assert value == {}
+
+    @pytest.mark.parametrize("params", ({"read-all-delay": 5000},))
+    def test_settings_read_timeout(self, portal_mock):
+        settings_intf = portal_mock.get_dbus_interface()
+
+        # The backend is skipped like in ReadAll(), and no other one has the key
+        start_time = time.perf_counter()
+        with pytest.raises(dbus.exceptions.DBusException) as excinfo:
+            settings_intf.ReadOne(
+                "org.freedesktop.appearance", "color-scheme", timeout=30
+            )
+        elapsed = time.perf_counter() - start_time
+
+        assert elapsed < 5
+        assert excinfo.value.get_dbus_name() == "org.freedesktop.portal.Error.NotFound"